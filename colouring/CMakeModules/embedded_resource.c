@@ -0,0 +1,55 @@
+/** @file
+ * @copydoc embedded_resource.h
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "embedded_resource.h"
+
+const unsigned char * embedded_resource_load(struct embedded_resource * res,
+                                             unsigned int * length)
+{
+    const unsigned char * trailer;
+    unsigned char * buffer;
+    unsigned int size;
+    z_stream stream;
+    int result;
+
+    if (res->inflated == NULL) {
+        /* Gzip trailer ends with uncompressed size, modulo 2^32, little endian */
+        if (res->length < 18) { return NULL; }
+        trailer = res->data + res->length - 4;
+        size = (unsigned int)trailer[0] | (unsigned int)trailer[1] << 8
+             | (unsigned int)trailer[2] << 16 | (unsigned int)trailer[3] << 24;
+
+        buffer = malloc((size_t)size + 1);
+        if (buffer == NULL) { return NULL; }
+
+        memset(&stream, 0, sizeof(stream));
+        stream.next_in = (Bytef *)res->data;
+        stream.avail_in = res->length;
+        stream.next_out = buffer;
+        stream.avail_out = size;
+        if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) { goto err_free_buffer; }
+        result = inflate(&stream, Z_FINISH);
+        inflateEnd(&stream);
+        if (result != Z_STREAM_END || stream.total_out != size) { goto err_free_buffer; }
+
+        buffer[size] = '\0';
+        res->inflated = buffer;
+        res->inflated_length = size;
+    }
+    if (length != NULL) { *length = res->inflated_length; }
+    return res->inflated;
+
+err_free_buffer:
+    free(buffer);
+    return NULL;
+}
+
+void embedded_resource_release(struct embedded_resource * res)
+{
+    free(res->inflated);
+    res->inflated = NULL;
+    res->inflated_length = 0;
+}
@@ -0,0 +1,50 @@
+/** @file
+ * Compressed embedded resources.
+ *
+ * Resources embedded with `embed_resources(... COMPRESSED ...)` are stored
+ * gzipped in the binary, and exposed as an embedded_resource structure. They
+ * are inflated into heap memory on first access.
+ */
+#ifndef EMBEDDED_RESOURCE_H
+#define EMBEDDED_RESOURCE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Compressed resource descriptor
+ *
+ * Instances are generated by the build system. Layout must match the
+ * assembly emitted by EmbedResources.cmake.
+ */
+struct embedded_resource {
+    const unsigned char *   data;               /**< Compressed data, gzip format */
+    unsigned char *         inflated;           /**< Inflated data, `NULL` until loaded */
+    unsigned int            length;             /**< Size of compressed data in bytes */
+    unsigned int            inflated_length;    /**< Size of inflated data in bytes */
+};
+
+/** Get inflated contents of a compressed resource
+ *
+ * Data is inflated on first call, then cached until embedded_resource_release()
+ * is called. Inflated data is always followed by a NUL byte, which is not
+ * included in its length. This function is not thread-safe.
+ * @param[in,out] res The resource to load.
+ * @param[out] length If not `NULL`, receives the size of data in bytes.
+ * @return Address of inflated data, or `NULL` if it could not be inflated.
+ */
+const unsigned char * embedded_resource_load(struct embedded_resource * res,
+                                             unsigned int * length);
+
+/** Free memory used by inflated contents of a compressed resource
+ *
+ * Resource can still be loaded again afterwards.
+ * @param[in,out] res The resource to release.
+ */
+void embedded_resource_release(struct embedded_resource * res);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,26 +1,123 @@
 /** @file
  * Image processing utilities.
  *
- * Enables loading images into SDL surfaces
+ * Enables loading images into SDL surfaces, either from a complete image in
+ * memory, or progressively as data becomes available.
  */
 #ifndef IMAGE_H
 #define IMAGE_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 struct SDL_Surface;
 
+/** Opaque structure representing a streaming image decoder */
+typedef struct image_decoder ImageDecoder;
+
+/** State of a streaming image decoder */
+enum image_decoder_status {
+    IMAGE_DECODER_ERROR = -1,   /**< Image is invalid or data ended prematurely */
+    IMAGE_DECODER_NEED_DATA,    /**< Decoder is waiting for more data */
+    IMAGE_DECODER_DONE          /**< Image was fully decoded */
+};
+
 /** Load an image from a memory buffer into a SDL surface
  *
  * The image must be a full, valid image file in
  * supported format. This means a PNG file at the moment, but it can be
  * extended to transparently identify and decode other image types.
+ *
+ * The surface is created in `SDL_PIXELFORMAT_ARGB8888` format, or
+ * `SDL_PIXELFORMAT_RGB888` for images without transparency. Those are native
+ * texture formats for most renderers, so creating a texture from it does not
+ * require another conversion.
  * @param[in] buffer Image data in supported format.
  * @param length Size in bytes of raw image data.
  * @return The loaded SDL_Surface. The caller is reponsible for calling
  *         [SDL_FreeSurface()](https://wiki.libsdl.org/SDL_FreeSurface)
- *         when done with it. Returns `NULL` if loading the image failed.
+ *         when done with it. Returns `NULL` if loading the image failed,
+ *         the reason being available from SDL_GetError().
  */
 SDL_Surface * image_load_buffer(const void * buffer, size_t length);
 
+/****************************************************************************/
+/** @name Streaming decoder
+ *
+ * A streaming decoder accepts image data in chunks of any size, for instance
+ * as it is read from a file descriptor or a socket, or by walking a memory
+ * mapping. The surface is created as soon as image headers are decoded, and
+ * rows are written into it as they become available. Interlaced images are
+ * shown progressively, each pass refining the previous one.
+ *
+ * Only the surface is kept in memory for non-interlaced images, encoded data
+ * can be discarded as soon as it has been fed to the decoder.
+ *  @{ */
+
+/** Create a streaming image decoder
+ * @return The newly created decoder, or `NULL` on failure. It must be freed
+ *         with image_decoder_destroy().
+ */
+ImageDecoder * image_decoder_create(void);
+
+/** Destroy a streaming image decoder
+ *
+ * The surface is destroyed as well, unless image_decoder_take_surface() was called.
+ * @param[in] decoder The decoder to destroy. It is safe to pass `NULL`.
+ */
+void image_decoder_destroy(ImageDecoder * decoder);
+
+/** Feed the next chunk of image data to the decoder
+ * @param[in,out] decoder The decoder.
+ * @param[in] data Image data, following the previously fed chunk. It need not
+ *                 remain valid after this function returns.
+ * @param length Size of data in bytes.
+ * @return The decoder status after processing the chunk. Once it is not
+ *         `IMAGE_DECODER_NEED_DATA`, additional data is ignored.
+ */
+enum image_decoder_status image_decoder_feed(ImageDecoder * decoder,
+                                             const void * data, size_t length);
+
+/** Read the next chunk of image data from a file descriptor
+ *
+ * Performs a single read(), then feeds the result to the decoder. If the
+ * descriptor is non-blocking and has no data available, nothing happens.
+ * Reaching end of file before the end of the image is an error.
+ * @param[in,out] decoder The decoder.
+ * @param fd The file descriptor to read from.
+ * @return The decoder status after processing the chunk.
+ */
+enum image_decoder_status image_decoder_feed_fd(ImageDecoder * decoder, int fd);
+
+/** Get the surface being decoded
+ *
+ * The surface can be displayed while the image is being decoded. Pixels
+ * not decoded yet are transparent black.
+ * @param[in] decoder The decoder.
+ * @return The surface, or `NULL` if image headers were not decoded yet. It
+ *         remains owned by the decoder.
+ */
+struct SDL_Surface * image_decoder_surface(const ImageDecoder * decoder);
+
+/** Take ownership of the surface being decoded
+ * @param[in,out] decoder The decoder.
+ * @return The surface, or `NULL` if image headers were not decoded yet. The
+ *         caller becomes responsible for freeing it, and must keep it alive
+ *         until decoder is destroyed or done.
+ */
+struct SDL_Surface * image_decoder_take_surface(ImageDecoder * decoder);
+
+/** Get rows of the surface that were updated since last call
+ *
+ * Typically used to only upload changed rows to a texture.
+ * @param[in,out] decoder The decoder.
+ * @param[out] first Index of first updated row.
+ * @param[out] count Number of updated rows, starting at `first`.
+ * @return `true` if some rows were updated, `false` otherwise. In the latter
+ *         case, `first` and `count` are left unmodified.
+ */
+bool image_decoder_rows_ready(ImageDecoder * decoder, unsigned * first, unsigned * count);
+
+/** @} */
+
 #endif
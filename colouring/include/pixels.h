@@ -0,0 +1,48 @@
+/** @file
+ * Pixel format conversion.
+ *
+ * Converts rows of decoded pixels into ARGB8888, which is the preferred texture
+ * format of most SDL renderers. Producing it directly when loading images lets
+ * SDL_CreateTextureFromSurface() upload pixels without converting them again.
+ *
+ * Conversion uses SSSE3 or AVX2 kernels when the CPU supports them, and falls
+ * back to portable code otherwise. The choice is made once, on first use.
+ */
+#ifndef PIXELS_H
+#define PIXELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Source pixel layouts, as decoded from image files */
+enum pixel_format {
+    PIXEL_FORMAT_GRAY,          /**< 8-bit luminance */
+    PIXEL_FORMAT_GRAY_ALPHA,    /**< 8-bit luminance, 8-bit alpha */
+    PIXEL_FORMAT_RGB,           /**< 8-bit red, green, blue */
+    PIXEL_FORMAT_RGBA,          /**< 8-bit red, green, blue, alpha */
+    PIXEL_FORMAT_INDEXED        /**< 8-bit index into a palette */
+};
+
+/** Get the size of a pixel
+ * @param format Source pixel layout.
+ * @return Size of one pixel in bytes.
+ */
+size_t pixel_format_size(enum pixel_format format);
+
+/** Convert a row of pixels to ARGB8888
+ *
+ * Output pixels are native-endian 32-bit values, alpha in the most significant
+ * byte, matching `SDL_PIXELFORMAT_ARGB8888`. Formats without alpha produce
+ * opaque pixels.
+ * @param[out] dst Destination buffer, able to hold `count` pixels.
+ * @param[in] src Source pixels, in `format` layout.
+ * @param count Number of pixels to convert.
+ * @param format Layout of source pixels.
+ * @param[in] palette For `PIXEL_FORMAT_INDEXED`, a table of 256 ARGB8888 colors.
+ *                    Ignored for other formats, and can be `NULL`.
+ * @pre `dst` and `src` do not overlap.
+ */
+void pixels_to_argb8888(uint32_t * dst, const unsigned char * src, size_t count,
+                        enum pixel_format format, const uint32_t * palette);
+
+#endif
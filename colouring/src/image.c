@@ -1,134 +1,315 @@
 /** @file
  * @copydoc image.h
  */
+#include <errno.h>
 #include <png.h>
 #include <SDL.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include "image.h"
+#include "pixels.h"
 
-/** Memory buffer descriptor
- *
- * Tracks current position in a memory buffer, ensuring it cannot be
- * overread.
- */
-struct buffer_pointer {
-    const void *    buffer;     /**< Address of memory buffer */
-    size_t          length;     /**< Total buffer size in bytes */
-    size_t          offset;     /**< Current offset; if offset == length we are at EOF */
+/** Size of chunks read by image_decoder_feed_fd() */
+#define IMAGE_DECODER_CHUNK_SIZE    16384
+
+struct image_decoder {
+    png_structp     png_ptr;        /**< libpng progressive reader */
+    png_infop       info_ptr;       /**< libpng image information */
+    enum image_decoder_status status; /**< Current decoding status */
+
+    SDL_Surface *   surface;        /**< Decoded image, `NULL` until headers are read */
+    bool            owns_surface;   /**< Whether surface must be freed with decoder */
+    enum pixel_format format;       /**< Layout of pixels produced by libpng */
+    uint32_t        palette[256];   /**< ARGB8888 color table for indexed images */
+    png_bytep       pixels;         /**< Native pixels, for interlaced images only */
+    size_t          row_size;       /**< Size of a native row in bytes */
+
+    unsigned        dirty_first;    /**< First row updated since last rows_ready call */
+    unsigned        dirty_end;      /**< Row past last row updated since last call */
 };
 
-static void image_buffer_reader(png_structp png_ptr, png_bytep out, png_size_t length);
+static void image_info_callback(png_structp png_ptr, png_infop info_ptr);
+static void image_row_callback(png_structp png_ptr, png_bytep row,
+                               png_uint_32 row_num, int pass);
+static void image_end_callback(png_structp png_ptr, png_infop info_ptr);
+static void image_read_palette(png_structp png_ptr, png_infop info_ptr, uint32_t * palette);
+
+/****************************************************************************/
+/** @name Streaming decoder
+ *  @{ */
+
+ImageDecoder * image_decoder_create(void)
+{
+    ImageDecoder * decoder = malloc(sizeof(*decoder));
+    if (decoder == NULL) { return NULL; }
+
+    decoder->png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (decoder->png_ptr == NULL) { goto err_free_decoder; }
+    decoder->info_ptr = png_create_info_struct(decoder->png_ptr);
+    if (decoder->info_ptr == NULL) { goto err_free_read; }
+    png_set_progressive_read_fn(decoder->png_ptr, decoder, image_info_callback,
+                                image_row_callback, image_end_callback);
+
+    decoder->status = IMAGE_DECODER_NEED_DATA;
+    decoder->surface = NULL;
+    decoder->owns_surface = true;
+    decoder->pixels = NULL;
+    decoder->dirty_first = 0;
+    decoder->dirty_end = 0;
+    return decoder;
+
+err_free_read:
+    png_destroy_read_struct(&decoder->png_ptr, NULL, NULL);
+err_free_decoder:
+    free(decoder);
+    return NULL;
+}
+
+void image_decoder_destroy(ImageDecoder * decoder)
+{
+    if (decoder == NULL) { return; }
+    png_destroy_read_struct(&decoder->png_ptr, &decoder->info_ptr, NULL);
+    free(decoder->pixels);
+    if (decoder->owns_surface) { SDL_FreeSurface(decoder->surface); }
+    free(decoder);
+}
+
+enum image_decoder_status image_decoder_feed(ImageDecoder * decoder,
+                                             const void * data, size_t length)
+{
+    if (decoder->status != IMAGE_DECODER_NEED_DATA) { return decoder->status; }
+
+    /* libpng reports errors by jumping back here */
+    if (setjmp(png_jmpbuf(decoder->png_ptr))) {
+        decoder->status = IMAGE_DECODER_ERROR;
+        return decoder->status;
+    }
+    png_process_data(decoder->png_ptr, decoder->info_ptr, (png_bytep)data, length);
+    return decoder->status;
+}
+
+enum image_decoder_status image_decoder_feed_fd(ImageDecoder * decoder, int fd)
+{
+    unsigned char buffer[IMAGE_DECODER_CHUNK_SIZE];
+    ssize_t length;
+
+    if (decoder->status != IMAGE_DECODER_NEED_DATA) { return decoder->status; }
+    do {
+        length = read(fd, buffer, sizeof(buffer));
+    } while (length < 0 && errno == EINTR);
+
+    if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { return decoder->status; }
+    if (length <= 0) {
+        /* Read error or end of file before end of image */
+        decoder->status = IMAGE_DECODER_ERROR;
+        return decoder->status;
+    }
+    return image_decoder_feed(decoder, buffer, (size_t)length);
+}
+
+SDL_Surface * image_decoder_surface(const ImageDecoder * decoder)
+{
+    return decoder->surface;
+}
+
+SDL_Surface * image_decoder_take_surface(ImageDecoder * decoder)
+{
+    decoder->owns_surface = false;
+    return decoder->surface;
+}
+
+bool image_decoder_rows_ready(ImageDecoder * decoder, unsigned * first, unsigned * count)
+{
+    if (decoder->dirty_first >= decoder->dirty_end) { return false; }
+    *first = decoder->dirty_first;
+    *count = decoder->dirty_end - decoder->dirty_first;
+    decoder->dirty_first = decoder->dirty_end = 0;
+    return true;
+}
+
+/** @} */
+/****************************************************************************/
 
 SDL_Surface * image_load_buffer(const void * buffer, size_t length)
 {
-    struct buffer_pointer pointer;
-    png_structp png_ptr = NULL;
-    png_infop info_ptr = NULL;
-    png_uint_32 width, height;
-    png_byte color_depth, color_type;
-    bool has_alpha;
-    png_bytep * row_pointers = NULL;
     SDL_Surface * surface = NULL;
-    unsigned y;
+    ImageDecoder * decoder = image_decoder_create();
+    if (decoder == NULL) {
+        SDL_SetError("cannot create image decoder");
+        return NULL;
+    }
 
-    /* Setup libpng for reading an image */
-    png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (png_ptr == NULL) { return NULL; }
-    info_ptr = png_create_info_struct(png_ptr);
-    if (info_ptr == NULL) { goto err_free_read; }
+    /* The whole image was given, so a decoder still waiting for data means it is truncated */
+    switch (image_decoder_feed(decoder, buffer, length)) {
+    case IMAGE_DECODER_DONE:
+        surface = image_decoder_take_surface(decoder);
+        break;
+    case IMAGE_DECODER_NEED_DATA:
+        SDL_SetError("image data is truncated");
+        break;
+    case IMAGE_DECODER_ERROR:
+        SDL_SetError("image data is invalid");
+        break;
+    }
+    image_decoder_destroy(decoder);
+    return surface;
+}
 
-    pointer.buffer  = buffer;
-    pointer.offset  = 0;
-    pointer.length  = length;
-    png_set_read_fn(png_ptr, &pointer, image_buffer_reader);
+/****************************************************************************/
+/** @name libpng callbacks
+ *  @{ */
+
+/** Prepare decoding once image headers are known
+ *
+ * Sets up libpng to decode pixels in their native layout, one byte per
+ * channel, and creates the target surface.
+ * @param[in] png_ptr Pointer to the png read structure.
+ * @param[in] info_ptr Pointer to the png info structure.
+ */
+static void image_info_callback(png_structp png_ptr, png_infop info_ptr)
+{
+    ImageDecoder * decoder = png_get_progressive_ptr(png_ptr);
+    png_uint_32 width, height;
+    png_byte color_depth, color_type;
+    bool has_alpha;
 
-    /* Read image headers */
-    png_read_info(png_ptr, info_ptr);
     width = png_get_image_width(png_ptr, info_ptr);
     height = png_get_image_height(png_ptr, info_ptr);
     color_depth = png_get_bit_depth(png_ptr, info_ptr);
     color_type = png_get_color_type(png_ptr, info_ptr);
 
+    /* Expansion to ARGB8888 is done by pixels_to_argb8888() */
     switch (color_type) {
     case PNG_COLOR_TYPE_GRAY:
-        png_set_gray_to_rgb(png_ptr);
-        has_alpha = false;
+        if (color_depth < 8) { png_set_expand_gray_1_2_4_to_8(png_ptr); }
+        decoder->format = PIXEL_FORMAT_GRAY;
         break;
     case PNG_COLOR_TYPE_GRAY_ALPHA:
-        png_set_gray_to_rgb(png_ptr);
-        has_alpha = true;
+        decoder->format = PIXEL_FORMAT_GRAY_ALPHA;
         break;
     case PNG_COLOR_TYPE_PALETTE:
-        png_set_palette_to_rgb(png_ptr);
-        /* fall-through */
+        if (color_depth < 8) { png_set_packing(png_ptr); }
+        image_read_palette(png_ptr, info_ptr, decoder->palette);
+        decoder->format = PIXEL_FORMAT_INDEXED;
+        break;
     case PNG_COLOR_TYPE_RGB:
-        if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
-            png_set_tRNS_to_alpha(png_ptr);
-            has_alpha = true;
-        } else {
-            has_alpha = false;
-        }
+        decoder->format = PIXEL_FORMAT_RGB;
         break;
     case PNG_COLOR_TYPE_RGB_ALPHA:
-        has_alpha = true;
+        decoder->format = PIXEL_FORMAT_RGBA;
         break;
     default:
-        goto err_free_read;
+        png_error(png_ptr, "unsupported color type");
+    }
+    has_alpha = (color_type & PNG_COLOR_MASK_ALPHA) != 0
+             || png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS);
+
+    /* Transparent color keys are rare, let libpng turn them into alpha */
+    if (color_type != PNG_COLOR_TYPE_PALETTE && png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
+        png_set_tRNS_to_alpha(png_ptr);
+        decoder->format = decoder->format == PIXEL_FORMAT_GRAY ? PIXEL_FORMAT_GRAY_ALPHA
+                                                               : PIXEL_FORMAT_RGBA;
     }
     if (color_depth == 16) { png_set_strip_16(png_ptr); }
+    png_set_interlace_handling(png_ptr);
+    png_read_update_info(png_ptr, info_ptr);
+    decoder->row_size = width * pixel_format_size(decoder->format);
 
-    /* Create SDL surface matching libpng pixel format */
-    surface = SDL_CreateRGBSurface(
-        0,
-        width, height,
-        has_alpha ? 32 : 24,
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-        0xff000000, 0x00ff0000, 0x0000ff00, has_alpha ? 0x000000ff : 0
-#else
-        0x000000ff, 0x0000ff00, 0x00ff0000, has_alpha ? 0xff000000 : 0
-#endif
+    /* Create SDL surface in the renderer's preferred texture format.
+     * It starts transparent black, and is filled as rows are decoded. */
+    decoder->surface = SDL_CreateRGBSurfaceWithFormat(
+        0, width, height, 32,
+        has_alpha ? SDL_PIXELFORMAT_ARGB8888 : SDL_PIXELFORMAT_RGB888
     );
-    if (surface == NULL) { goto err_free_read; }
+    if (decoder->surface == NULL) { png_error(png_ptr, SDL_GetError()); }
 
-    /* Decompress image into SDL surface */
-    SDL_LockSurface(surface);
-    row_pointers = malloc(sizeof(png_bytep) * height);
-    if (row_pointers == NULL) { goto err_free_surface; }
-    for (y = 0; y < height; y += 1) {
-        row_pointers[y] = (unsigned char*)surface->pixels + y * surface->pitch;
+    /* Interlaced passes only carry some pixels of each row, so native rows
+     * must be kept around to combine them. Others are converted on the fly. */
+    if (png_get_interlace_type(png_ptr, info_ptr) != PNG_INTERLACE_NONE) {
+        decoder->pixels = calloc(height, decoder->row_size);
+        if (decoder->pixels == NULL) { png_error(png_ptr, "out of memory"); }
     }
-    png_read_image(png_ptr, row_pointers);
-    free(row_pointers);
-    SDL_UnlockSurface(surface);
+}
 
-    /* Cleanup */
-    png_read_end(png_ptr, NULL);
-    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-    return surface;
+/** Convert a freshly decoded row into the surface
+ * @param[in] png_ptr Pointer to the png read structure.
+ * @param[in] row Decoded row data, or `NULL` if the row did not change during
+ *                this pass.
+ * @param row_num Index of the row in the image.
+ * @param pass Interlacing pass the row belongs to.
+ */
+static void image_row_callback(png_structp png_ptr, png_bytep row,
+                               png_uint_32 row_num, int pass)
+{
+    ImageDecoder * decoder = png_get_progressive_ptr(png_ptr);
+    SDL_Surface * surface = decoder->surface;
+    (void)pass;
 
-err_free_surface:
-    SDL_FreeSurface(surface);
-err_free_read:
-    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-    return NULL;
+    if (row == NULL) { return; }
+    if (decoder->pixels != NULL) {
+        png_bytep native = decoder->pixels + row_num * decoder->row_size;
+        png_progressive_combine_row(png_ptr, native, row);
+        row = native;
+    }
+
+    SDL_LockSurface(surface);
+    pixels_to_argb8888((uint32_t *)((unsigned char*)surface->pixels + row_num * surface->pitch),
+                       row, (size_t)surface->w, decoder->format, decoder->palette);
+    SDL_UnlockSurface(surface);
+
+    if (decoder->dirty_first >= decoder->dirty_end) {
+        decoder->dirty_first = row_num;
+        decoder->dirty_end = row_num + 1;
+    } else {
+        if (row_num < decoder->dirty_first) { decoder->dirty_first = row_num; }
+        if (row_num >= decoder->dirty_end) { decoder->dirty_end = row_num + 1; }
+    }
 }
 
-/** Memory-based image reader for libpng
+/** Finish decoding
  *
- * Gets the next data chunk from the memory buffer.
+ * Releases native pixels of interlaced images, which are no longer needed.
  * @param[in] png_ptr Pointer to the png read structure.
- * @param[out] out Memory address where to put read data.
- * @param length Number of bytes to read.
+ * @param[in] info_ptr Pointer to the png info structure.
  */
-static void image_buffer_reader(png_structp png_ptr, png_bytep out, png_size_t length)
+static void image_end_callback(png_structp png_ptr, png_infop info_ptr)
 {
-    struct buffer_pointer * pointer = (struct buffer_pointer *)png_get_io_ptr(png_ptr);
-    if(pointer == NULL) { return; }
+    ImageDecoder * decoder = png_get_progressive_ptr(png_ptr);
+    (void)info_ptr;
+
+    free(decoder->pixels);
+    decoder->pixels = NULL;
+    decoder->status = IMAGE_DECODER_DONE;
+}
 
-    size_t clamped_length = pointer->offset + length <= pointer->length
-                          ? length
-                          : pointer->length - pointer->offset;
+/** @} */
+/****************************************************************************/
+
+/** Build an ARGB8888 color table from an image's palette
+ *
+ * Entries missing from the palette are set to opaque black.
+ * @param[in] png_ptr Pointer to the png read structure.
+ * @param[in] info_ptr Pointer to the png info structure.
+ * @param[out] palette Color table with 256 entries.
+ */
+static void image_read_palette(png_structp png_ptr, png_infop info_ptr, uint32_t * palette)
+{
+    png_colorp colors = NULL;
+    png_bytep alphas = NULL;
+    int nb_colors = 0, nb_alphas = 0;
+    int i;
 
-    memcpy(out, (char*)pointer->buffer + pointer->offset, clamped_length);
-    pointer->offset += clamped_length;
+    png_get_PLTE(png_ptr, info_ptr, &colors, &nb_colors);
+    if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
+        png_get_tRNS(png_ptr, info_ptr, &alphas, &nb_alphas, NULL);
+    }
+    for (i = 0; i < 256; i += 1) {
+        uint32_t alpha = i < nb_alphas ? alphas[i] : 0xff;
+        palette[i] = i < nb_colors
+                   ? alpha << 24 | (uint32_t)colors[i].red << 16
+                   | (uint32_t)colors[i].green << 8 | colors[i].blue
+                   : 0xff000000u;
+    }
 }
@@ -0,0 +1,225 @@
+/** @file
+ * @copydoc pixels.h
+ */
+#include <stdbool.h>
+#include "pixels.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PIXELS_X86      /**< Defined when x86 SIMD kernels are available */
+#include <immintrin.h>
+#endif
+
+/** Signature of a conversion kernel */
+typedef void (*pixel_kernel)(uint32_t * dst, const unsigned char * src, size_t count);
+
+/****************************************************************************/
+/** @name Portable kernels
+ *  @{ */
+
+static void gray_generic(uint32_t * dst, const unsigned char * src, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i += 1) {
+        dst[i] = 0xff000000u | src[i] * 0x010101u;
+    }
+}
+
+static void gray_alpha_generic(uint32_t * dst, const unsigned char * src, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i += 1) {
+        dst[i] = (uint32_t)src[2 * i + 1] << 24 | src[2 * i] * 0x010101u;
+    }
+}
+
+static void rgb_generic(uint32_t * dst, const unsigned char * src, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i += 1) {
+        dst[i] = 0xff000000u | (uint32_t)src[3 * i] << 16
+               | (uint32_t)src[3 * i + 1] << 8 | src[3 * i + 2];
+    }
+}
+
+static void rgba_generic(uint32_t * dst, const unsigned char * src, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i += 1) {
+        dst[i] = (uint32_t)src[4 * i + 3] << 24 | (uint32_t)src[4 * i] << 16
+               | (uint32_t)src[4 * i + 1] << 8 | src[4 * i + 2];
+    }
+}
+
+/** @} */
+/****************************************************************************/
+/** @name x86 kernels
+ *
+ * x86 is little-endian, so an ARGB8888 pixel is stored as bytes B, G, R, A.
+ * Kernels process as many pixels as they can in vector registers, then hand
+ * the remainder over to the portable kernel.
+ *  @{ */
+#ifdef PIXELS_X86
+
+__attribute__((target("sse2")))
+static void gray_sse2(uint32_t * dst, const unsigned char * src, size_t count)
+{
+    const __m128i alpha = _mm_set1_epi8((char)0xff);
+    size_t i;
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m128i g = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i gg_lo = _mm_unpacklo_epi8(g, g), gg_hi = _mm_unpackhi_epi8(g, g);
+        __m128i ga_lo = _mm_unpacklo_epi8(g, alpha), ga_hi = _mm_unpackhi_epi8(g, alpha);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi16(gg_lo, ga_lo));
+        _mm_storeu_si128((__m128i *)(dst + i + 4), _mm_unpackhi_epi16(gg_lo, ga_lo));
+        _mm_storeu_si128((__m128i *)(dst + i + 8), _mm_unpacklo_epi16(gg_hi, ga_hi));
+        _mm_storeu_si128((__m128i *)(dst + i + 12), _mm_unpackhi_epi16(gg_hi, ga_hi));
+    }
+    gray_generic(dst + i, src + i, count - i);
+}
+
+__attribute__((target("ssse3")))
+static void gray_alpha_ssse3(uint32_t * dst, const unsigned char * src, size_t count)
+{
+    const __m128i lo = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+    const __m128i hi = _mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+    size_t i;
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m128i ga = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(ga, lo));
+        _mm_storeu_si128((__m128i *)(dst + i + 4), _mm_shuffle_epi8(ga, hi));
+    }
+    gray_alpha_generic(dst + i, src + 2 * i, count - i);
+}
+
+__attribute__((target("ssse3")))
+static void rgb_ssse3(uint32_t * dst, const unsigned char * src, size_t count)
+{
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xff000000u);
+    size_t i;
+    for (i = 0; i + 16 <= count; i += 16) {
+        /* 16 pixels span exactly three registers, realign them in groups of 4 */
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 3 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 3 * i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + 3 * i + 32));
+        __m128i p0 = a;
+        __m128i p1 = _mm_alignr_epi8(b, a, 12);
+        __m128i p2 = _mm_alignr_epi8(c, b, 8);
+        __m128i p3 = _mm_srli_si128(c, 4);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_shuffle_epi8(p0, mask), alpha));
+        _mm_storeu_si128((__m128i *)(dst + i + 4), _mm_or_si128(_mm_shuffle_epi8(p1, mask), alpha));
+        _mm_storeu_si128((__m128i *)(dst + i + 8), _mm_or_si128(_mm_shuffle_epi8(p2, mask), alpha));
+        _mm_storeu_si128((__m128i *)(dst + i + 12), _mm_or_si128(_mm_shuffle_epi8(p3, mask), alpha));
+    }
+    rgb_generic(dst + i, src + 3 * i, count - i);
+}
+
+__attribute__((target("ssse3")))
+static void rgba_ssse3(uint32_t * dst, const unsigned char * src, size_t count)
+{
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t i;
+    for (i = 0; i + 4 <= count; i += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(p, mask));
+    }
+    rgba_generic(dst + i, src + 4 * i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void rgb_avx2(uint32_t * dst, const unsigned char * src, size_t count)
+{
+    const __m256i mask = _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                                          2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m256i alpha = _mm256_set1_epi32((int)0xff000000u);
+    size_t i;
+    /* Each lane loads 16 bytes to use 12, so keep 2 pixels of slack at the end */
+    for (i = 0; i + 10 <= count; i += 8) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src + 3 * i));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src + 3 * i + 12));
+        __m256i p = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        p = _mm256_or_si256(_mm256_shuffle_epi8(p, mask), alpha);
+        _mm256_storeu_si256((__m256i *)(dst + i), p);
+    }
+    rgb_generic(dst + i, src + 3 * i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void rgba_avx2(uint32_t * dst, const unsigned char * src, size_t count)
+{
+    const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                          2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t i;
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(src + 4 * i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_shuffle_epi8(p, mask));
+    }
+    rgba_generic(dst + i, src + 4 * i, count - i);
+}
+
+#endif
+/** @} */
+/****************************************************************************/
+
+/** Kernels selected for current CPU */
+static struct {
+    bool            ready;          /**< Whether kernels were selected already */
+    pixel_kernel    gray;           /**< PIXEL_FORMAT_GRAY converter */
+    pixel_kernel    gray_alpha;     /**< PIXEL_FORMAT_GRAY_ALPHA converter */
+    pixel_kernel    rgb;            /**< PIXEL_FORMAT_RGB converter */
+    pixel_kernel    rgba;           /**< PIXEL_FORMAT_RGBA converter */
+} kernels;
+
+/** Pick the best kernels supported by the CPU we are running on */
+static void select_kernels(void)
+{
+    kernels.gray = gray_generic;
+    kernels.gray_alpha = gray_alpha_generic;
+    kernels.rgb = rgb_generic;
+    kernels.rgba = rgba_generic;
+#ifdef PIXELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        kernels.gray = gray_sse2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        kernels.gray_alpha = gray_alpha_ssse3;
+        kernels.rgb = rgb_ssse3;
+        kernels.rgba = rgba_ssse3;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.rgb = rgb_avx2;
+        kernels.rgba = rgba_avx2;
+    }
+#endif
+    kernels.ready = true;
+}
+
+size_t pixel_format_size(enum pixel_format format)
+{
+    switch (format) {
+    case PIXEL_FORMAT_GRAY:         return 1;
+    case PIXEL_FORMAT_GRAY_ALPHA:   return 2;
+    case PIXEL_FORMAT_RGB:          return 3;
+    case PIXEL_FORMAT_RGBA:         return 4;
+    case PIXEL_FORMAT_INDEXED:      return 1;
+    }
+    return 0;
+}
+
+void pixels_to_argb8888(uint32_t * dst, const unsigned char * src, size_t count,
+                        enum pixel_format format, const uint32_t * palette)
+{
+    size_t i;
+    if (!kernels.ready) { select_kernels(); }
+
+    switch (format) {
+    case PIXEL_FORMAT_GRAY:         kernels.gray(dst, src, count); break;
+    case PIXEL_FORMAT_GRAY_ALPHA:   kernels.gray_alpha(dst, src, count); break;
+    case PIXEL_FORMAT_RGB:          kernels.rgb(dst, src, count); break;
+    case PIXEL_FORMAT_RGBA:         kernels.rgba(dst, src, count); break;
+    case PIXEL_FORMAT_INDEXED:
+        for (i = 0; i < count; i += 1) { dst[i] = palette[src[i]]; }
+        break;
+    }
+}
@@ -0,0 +1,246 @@
+#include <check.h>
+#include <SDL.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "image.h"
+
+/* 6x5 RGBA image, non-interlaced, pixel (x, y) being
+ * red x*40, green y*50, blue x+y*6 and alpha 255-x*10 */
+static const unsigned char test_png[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x05,
+    0x08, 0x06, 0x00, 0x00, 0x00, 0x66, 0x58, 0x9d, 0xe6, 0x00, 0x00, 0x00,
+    0x73, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x0d, 0xc9, 0xa7, 0x01, 0x45,
+    0x21, 0x10, 0x04, 0xc0, 0xfd, 0x39, 0xe7, 0x9c, 0x3c, 0xfa, 0x2a, 0xa1,
+    0x88, 0x2b, 0x82, 0x4a, 0x4e, 0x53, 0xce, 0x9a, 0xa7, 0xd1, 0x68, 0x34,
+    0x9a, 0xcf, 0xd8, 0x01, 0x80, 0xe6, 0x30, 0xaa, 0x1e, 0xe3, 0x12, 0x30,
+    0xc9, 0x11, 0xd3, 0x44, 0xcc, 0x06, 0x40, 0xe6, 0xcd, 0xc9, 0xa2, 0x7a,
+    0x59, 0x96, 0x20, 0xab, 0x1c, 0x65, 0x9d, 0x28, 0x9b, 0x1e, 0xba, 0x6d,
+    0x4e, 0x77, 0xd5, 0xeb, 0xbe, 0x04, 0x3d, 0xe4, 0xa8, 0xc7, 0x44, 0x3d,
+    0xf5, 0xb0, 0x73, 0x73, 0x76, 0xa9, 0xde, 0xae, 0x25, 0xd8, 0x2d, 0x47,
+    0xbb, 0x27, 0xda, 0xa3, 0x07, 0x9f, 0xcd, 0xf1, 0x55, 0x3d, 0xdf, 0x25,
+    0xf0, 0x93, 0x23, 0xbf, 0x89, 0xfc, 0x0d, 0x7f, 0x34, 0x66, 0x34, 0x18,
+    0xcd, 0x2e, 0xe2, 0xea, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44,
+    0xae, 0x42, 0x60, 0x82,
+};
+#define test_png_width  6
+#define test_png_height 5
+#define test_png_idat   41      /* Offset of compressed pixel data */
+
+/* Same image, Adam7-interlaced */
+static const unsigned char test_png_adam7[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x05,
+    0x08, 0x06, 0x00, 0x00, 0x01, 0x11, 0x5f, 0xad, 0x70, 0x00, 0x00, 0x00,
+    0x51, 0x49, 0x44, 0x41, 0x54, 0x08, 0xd7, 0x65, 0xca, 0xb1, 0x11, 0x80,
+    0x20, 0x10, 0x05, 0xd1, 0xfd, 0x37, 0x8c, 0x11, 0x05, 0x50, 0x02, 0xb1,
+    0x95, 0x50, 0x04, 0x85, 0x51, 0x0e, 0x1d, 0x68, 0x0f, 0x90, 0x6a, 0x7a,
+    0x26, 0x1a, 0xa8, 0xc1, 0x06, 0x6f, 0x66, 0x01, 0x9c, 0x46, 0xd8, 0x44,
+    0x4f, 0xde, 0x08, 0x3b, 0x05, 0x1b, 0x46, 0x4f, 0x88, 0x1a, 0xbd, 0x60,
+    0xb3, 0x60, 0x53, 0x19, 0x1d, 0x0f, 0x02, 0x35, 0x02, 0x06, 0x18, 0x2f,
+    0x88, 0x75, 0xf1, 0x8c, 0xce, 0x6f, 0xf7, 0xa5, 0x5f, 0x17, 0x7d, 0x16,
+    0x17, 0xb9, 0x8e, 0xda, 0xf0, 0x09, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45,
+    0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+#define test_png_adam7_chunk 7  /* Feed size, splitting passes across calls */
+
+static uint32_t expected_pixel(unsigned x, unsigned y)
+{
+    return (uint32_t)(255 - x * 10) << 24 | (uint32_t)(x * 40) << 16
+         | (uint32_t)(y * 50) << 8 | (x + y * 6);
+}
+
+static uint32_t surface_pixel(SDL_Surface * surface, unsigned x, unsigned y)
+{
+    return ((const uint32_t *)((const unsigned char *)surface->pixels + y * surface->pitch))[x];
+}
+
+START_TEST(test_image_load_buffer)
+{
+    unsigned x, y;
+    SDL_Surface * surface = image_load_buffer(test_png, sizeof(test_png));
+    ck_assert_ptr_ne(surface, NULL);
+    ck_assert_int_eq(surface->w, test_png_width);
+    ck_assert_int_eq(surface->h, test_png_height);
+    for (y = 0; y < test_png_height; y += 1) {
+        for (x = 0; x < test_png_width; x += 1) {
+            ck_assert_uint_eq(surface_pixel(surface, x, y), expected_pixel(x, y));
+        }
+    }
+    SDL_FreeSurface(surface);
+}
+END_TEST
+
+START_TEST(test_image_load_buffer_truncated)
+{
+    SDL_ClearError();
+    ck_assert_ptr_eq(image_load_buffer(test_png, sizeof(test_png) - 20), NULL);
+    ck_assert_msg(SDL_GetError()[0] != '\0', "truncated image reported no error");
+}
+END_TEST
+
+START_TEST(test_image_decoder_bytewise)
+{
+    unsigned rows[test_png_height] = { 0 };
+    unsigned first, count, i, x, y;
+    enum image_decoder_status status = IMAGE_DECODER_NEED_DATA;
+    ImageDecoder * decoder = image_decoder_create();
+    ck_assert_ptr_ne(decoder, NULL);
+
+    /* Feeding one byte at a time, every row is reported exactly once */
+    for (i = 0; i < sizeof(test_png); i += 1) {
+        ck_assert_int_eq(status, IMAGE_DECODER_NEED_DATA);
+        status = image_decoder_feed(decoder, test_png + i, 1);
+        if (image_decoder_rows_ready(decoder, &first, &count)) {
+            ck_assert_uint_le(first + count, test_png_height);
+            for (y = first; y < first + count; y += 1) { rows[y] += 1; }
+        }
+    }
+    ck_assert_int_eq(status, IMAGE_DECODER_DONE);
+    ck_assert_msg(!image_decoder_rows_ready(decoder, &first, &count), "rows reported twice");
+    for (y = 0; y < test_png_height; y += 1) { ck_assert_uint_eq(rows[y], 1); }
+
+    /* Result matches the image decoded in one go */
+    ck_assert_ptr_ne(image_decoder_surface(decoder), NULL);
+    for (y = 0; y < test_png_height; y += 1) {
+        for (x = 0; x < test_png_width; x += 1) {
+            ck_assert_uint_eq(surface_pixel(image_decoder_surface(decoder), x, y),
+                              expected_pixel(x, y));
+        }
+    }
+
+    /* Data past the end is ignored */
+    ck_assert_int_eq(image_decoder_feed(decoder, test_png, 1), IMAGE_DECODER_DONE);
+    image_decoder_destroy(decoder);
+}
+END_TEST
+
+START_TEST(test_image_decoder_interlaced)
+{
+    unsigned first, count, reports = 0, i, x, y;
+    enum image_decoder_status status = IMAGE_DECODER_NEED_DATA;
+    SDL_Surface * expected = image_load_buffer(test_png_adam7, sizeof(test_png_adam7));
+    ImageDecoder * decoder = image_decoder_create();
+    ck_assert_ptr_ne(expected, NULL);
+    ck_assert_ptr_ne(decoder, NULL);
+
+    /* Every pass refines rows again, so they may be reported several times */
+    for (i = 0; i < sizeof(test_png_adam7); i += test_png_adam7_chunk) {
+        size_t size = sizeof(test_png_adam7) - i;
+        if (size > test_png_adam7_chunk) { size = test_png_adam7_chunk; }
+        ck_assert_int_eq(status, IMAGE_DECODER_NEED_DATA);
+        status = image_decoder_feed(decoder, test_png_adam7 + i, size);
+        if (image_decoder_rows_ready(decoder, &first, &count)) {
+            ck_assert_uint_le(first + count, test_png_height);
+            reports += 1;
+        }
+    }
+    ck_assert_int_eq(status, IMAGE_DECODER_DONE);
+    ck_assert_uint_gt(reports, 1);
+
+    /* Result matches the image decoded in one go, which matches the original */
+    ck_assert_int_eq(image_decoder_surface(decoder)->w, test_png_width);
+    ck_assert_int_eq(image_decoder_surface(decoder)->h, test_png_height);
+    for (y = 0; y < test_png_height; y += 1) {
+        for (x = 0; x < test_png_width; x += 1) {
+            ck_assert_uint_eq(surface_pixel(image_decoder_surface(decoder), x, y),
+                              surface_pixel(expected, x, y));
+            ck_assert_uint_eq(surface_pixel(expected, x, y), expected_pixel(x, y));
+        }
+    }
+    SDL_FreeSurface(expected);
+    image_decoder_destroy(decoder);
+}
+END_TEST
+
+START_TEST(test_image_decoder_take_surface)
+{
+    SDL_Surface * surface;
+    ImageDecoder * decoder = image_decoder_create();
+    ck_assert_ptr_ne(decoder, NULL);
+    ck_assert_ptr_eq(image_decoder_take_surface(decoder), NULL);
+
+    ck_assert_int_eq(image_decoder_feed(decoder, test_png, sizeof(test_png)), IMAGE_DECODER_DONE);
+    surface = image_decoder_take_surface(decoder);
+    ck_assert_ptr_ne(surface, NULL);
+    image_decoder_destroy(decoder);
+
+    /* Surface outlives the decoder */
+    ck_assert_uint_eq(surface_pixel(surface, 1, 2), expected_pixel(1, 2));
+    SDL_FreeSurface(surface);
+}
+END_TEST
+
+START_TEST(test_image_decoder_feed_fd)
+{
+    int fds[2];
+    enum image_decoder_status status;
+    ImageDecoder * decoder = image_decoder_create();
+    ck_assert_ptr_ne(decoder, NULL);
+    ck_assert_int_eq(pipe(fds), 0);
+    ck_assert_int_eq(write(fds[1], test_png, sizeof(test_png)), (int)sizeof(test_png));
+    close(fds[1]);
+
+    do { status = image_decoder_feed_fd(decoder, fds[0]); } while (status == IMAGE_DECODER_NEED_DATA);
+    ck_assert_int_eq(status, IMAGE_DECODER_DONE);
+    ck_assert_uint_eq(surface_pixel(image_decoder_surface(decoder), 5, 4), expected_pixel(5, 4));
+
+    close(fds[0]);
+    image_decoder_destroy(decoder);
+}
+END_TEST
+
+START_TEST(test_image_decoder_truncated)
+{
+    /* A truncated image may go on later, until end of file says it will not */
+    int fds[2];
+    enum image_decoder_status status;
+    ImageDecoder * decoder = image_decoder_create();
+    ck_assert_ptr_ne(decoder, NULL);
+    ck_assert_int_eq(pipe(fds), 0);
+    ck_assert_int_eq(write(fds[1], test_png, sizeof(test_png) - 20), (int)sizeof(test_png) - 20);
+    close(fds[1]);
+
+    do { status = image_decoder_feed_fd(decoder, fds[0]); } while (status == IMAGE_DECODER_NEED_DATA);
+    ck_assert_int_eq(status, IMAGE_DECODER_ERROR);
+
+    close(fds[0]);
+    image_decoder_destroy(decoder);
+}
+END_TEST
+
+static void check_corrupt(size_t offset)
+{
+    unsigned char data[sizeof(test_png)];
+    ImageDecoder * decoder = image_decoder_create();
+    ck_assert_ptr_ne(decoder, NULL);
+
+    memcpy(data, test_png, sizeof(data));
+    data[offset] ^= 0x55;
+    ck_assert_int_eq(image_decoder_feed(decoder, data, sizeof(data)), IMAGE_DECODER_ERROR);
+    /* Once failed, it stays so */
+    ck_assert_int_eq(image_decoder_feed(decoder, test_png, sizeof(test_png)), IMAGE_DECODER_ERROR);
+    image_decoder_destroy(decoder);
+}
+
+START_TEST(test_image_decoder_bad_signature)   { check_corrupt(1); }                   END_TEST
+START_TEST(test_image_decoder_bad_data)        { check_corrupt(test_png_idat + 20); }  END_TEST
+
+Suite * build_image_suite()
+{
+    Suite * s = suite_create("image");
+    TCase * tc = tcase_create("Core");
+    tcase_add_test(tc, test_image_load_buffer);
+    tcase_add_test(tc, test_image_load_buffer_truncated);
+    tcase_add_test(tc, test_image_decoder_bytewise);
+    tcase_add_test(tc, test_image_decoder_interlaced);
+    tcase_add_test(tc, test_image_decoder_take_surface);
+    tcase_add_test(tc, test_image_decoder_feed_fd);
+    tcase_add_test(tc, test_image_decoder_truncated);
+    tcase_add_test(tc, test_image_decoder_bad_signature);
+    tcase_add_test(tc, test_image_decoder_bad_data);
+    suite_add_tcase(s, tc);
+    return s;
+}
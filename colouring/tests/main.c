@@ -7,6 +7,8 @@ Suite * build_main_suite()
     return s;
 }
 
+Suite * build_image_suite();
+Suite * build_pixels_suite();
 Suite * build_stack_suite();
 Suite * build_world_suite();
 
@@ -15,6 +17,8 @@ int main()
     int failed;
 
     SRunner * sr = srunner_create(build_main_suite());
+    srunner_add_suite(sr, build_image_suite());
+    srunner_add_suite(sr, build_pixels_suite());
     srunner_add_suite(sr, build_stack_suite());
     srunner_add_suite(sr, build_world_suite());
 
@@ -0,0 +1,80 @@
+#include <check.h>
+#include <stdint.h>
+#include "pixels.h"
+
+/* Long enough to go through SIMD kernels, odd so the remainder is exercised */
+#define test_pixel_count 67
+
+static unsigned char source[4 * test_pixel_count];
+static uint32_t palette[256];
+
+static void setup_source(void)
+{
+    unsigned i;
+    for (i = 0; i < sizeof(source); i += 1) { source[i] = (unsigned char)(i * 37 + 11); }
+    for (i = 0; i < 256; i += 1) { palette[i] = 0x01020304u * i; }
+}
+
+/* Reference conversion, one pixel at a time */
+static uint32_t expected_pixel(enum pixel_format format, const unsigned char * p)
+{
+    switch (format) {
+    case PIXEL_FORMAT_GRAY:         return 0xff000000u | p[0] * 0x010101u;
+    case PIXEL_FORMAT_GRAY_ALPHA:   return (uint32_t)p[1] << 24 | p[0] * 0x010101u;
+    case PIXEL_FORMAT_RGB:          return 0xff000000u | (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+    case PIXEL_FORMAT_RGBA:         return (uint32_t)p[3] << 24 | (uint32_t)p[0] << 16
+                                         | (uint32_t)p[1] << 8 | p[2];
+    case PIXEL_FORMAT_INDEXED:      return palette[p[0]];
+    }
+    return 0;
+}
+
+static void check_format(enum pixel_format format)
+{
+    uint32_t result[test_pixel_count + 1];
+    unsigned count, i;
+
+    for (count = 0; count <= test_pixel_count; count += 1) {
+        result[count] = 0xdeadbeef;
+        pixels_to_argb8888(result, source, count, format, palette);
+        for (i = 0; i < count; i += 1) {
+            ck_assert_uint_eq(result[i],
+                              expected_pixel(format, source + i * pixel_format_size(format)));
+        }
+        ck_assert_msg(result[count] == 0xdeadbeef, "conversion overflowed destination");
+    }
+}
+
+START_TEST(test_pixels_sizes)
+{
+    ck_assert_uint_eq(pixel_format_size(PIXEL_FORMAT_GRAY), 1);
+    ck_assert_uint_eq(pixel_format_size(PIXEL_FORMAT_GRAY_ALPHA), 2);
+    ck_assert_uint_eq(pixel_format_size(PIXEL_FORMAT_RGB), 3);
+    ck_assert_uint_eq(pixel_format_size(PIXEL_FORMAT_RGBA), 4);
+    ck_assert_uint_eq(pixel_format_size(PIXEL_FORMAT_INDEXED), 1);
+}
+END_TEST
+
+START_TEST(test_pixels_gray)         { check_format(PIXEL_FORMAT_GRAY); }          END_TEST
+START_TEST(test_pixels_gray_alpha)   { check_format(PIXEL_FORMAT_GRAY_ALPHA); }    END_TEST
+START_TEST(test_pixels_rgb)          { check_format(PIXEL_FORMAT_RGB); }           END_TEST
+START_TEST(test_pixels_rgba)         { check_format(PIXEL_FORMAT_RGBA); }          END_TEST
+START_TEST(test_pixels_indexed)      { check_format(PIXEL_FORMAT_INDEXED); }       END_TEST
+
+/****************************************************************************/
+
+Suite * build_pixels_suite()
+{
+    Suite * s = suite_create("pixels");
+    TCase * tc = tcase_create("Core");
+    tcase_add_checked_fixture(tc, setup_source, NULL);
+    tcase_add_test(tc, test_pixels_sizes);
+    tcase_add_test(tc, test_pixels_gray);
+    tcase_add_test(tc, test_pixels_gray_alpha);
+    tcase_add_test(tc, test_pixels_rgb);
+    tcase_add_test(tc, test_pixels_rgba);
+    tcase_add_test(tc, test_pixels_indexed);
+
+    suite_add_tcase(s, tc);
+    return s;
+}
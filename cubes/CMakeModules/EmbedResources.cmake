@@ -0,0 +1,127 @@
+# - Embed binary files into an executable using the assembler .incbin directive
+#
+# This replaces the classic `xxd -i` approach: instead of generating a huge C
+# array that the compiler must parse, a tiny assembly stub is generated for
+# each resource, and the assembler copies the file verbatim into the object.
+# Build time no longer depends on resource size.
+#
+#   embed_resources(<var> [ALIGN <bytes>] [COMPRESSED] FILES <file>...)
+#
+# Paths are relative to the current source directory. For each file, a symbol
+# name is derived from its path exactly as xxd does, by replacing anything that
+# is not alphanumeric with an underscore. Thus `resources/icon.png` yields:
+#
+#   const unsigned char resources_icon_png[];   - file contents, aligned to
+#                                                  ALIGN bytes (default 16) and
+#                                                  followed by a NUL byte that
+#                                                  is not counted in length.
+#   const unsigned int  resources_icon_png_len; - file size in bytes.
+#
+# Those are drop-in replacements for symbols generated by `xxd -i`.
+#
+# With COMPRESSED, files are gzipped at build time and each symbol is instead
+# a `struct embedded_resource` (see embedded_resource.h in this directory),
+# which is inflated on first access by embedded_resource_load(). The support
+# source is appended to <var> and ${EMBED_RESOURCES_INCLUDE_DIR} must be added
+# to include paths. Target must link ZLIB::ZLIB. Loading is not thread-safe:
+# first access to a given resource must not race with another.
+#
+# Names of generated sources are appended to <var>.
+# Requires a GNU-compatible assembler targeting ELF.
+
+enable_language(C)
+enable_language(ASM)
+set(EMBED_RESOURCES_INCLUDE_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+function(embed_resources VAR)
+    cmake_parse_arguments(EMBED "COMPRESSED" "ALIGN" "FILES" ${ARGN})
+    if(NOT EMBED_ALIGN)
+        set(EMBED_ALIGN 16)
+    endif()
+    if(EMBED_COMPRESSED)
+        find_package(ZLIB REQUIRED)
+        find_program(GZIP_EXECUTABLE gzip)
+        if(NOT GZIP_EXECUTABLE)
+            message(FATAL_ERROR "gzip is required to embed compressed resources")
+        endif()
+    endif()
+
+    set(SOURCES ${${VAR}})
+    foreach(INPUT_FILE ${EMBED_FILES})
+        string(MAKE_C_IDENTIFIER ${INPUT_FILE} SYMBOL)
+        set(INPUT_PATH ${CMAKE_CURRENT_SOURCE_DIR}/${INPUT_FILE})
+        set(OUTPUT_FILE ${CMAKE_CURRENT_BINARY_DIR}/${INPUT_FILE}.S)
+        get_filename_component(OUTPUT_DIRECTORY ${OUTPUT_FILE} DIRECTORY)
+        file(MAKE_DIRECTORY ${OUTPUT_DIRECTORY})
+
+        if(EMBED_COMPRESSED)
+            set(BLOB_PATH ${CMAKE_CURRENT_BINARY_DIR}/${INPUT_FILE}.gz)
+            set(BLOB_SYMBOL ${SYMBOL}_z)
+            add_custom_command(
+                OUTPUT ${BLOB_PATH}
+                COMMAND ${GZIP_EXECUTABLE} -9 -n -c ${INPUT_PATH} > ${BLOB_PATH}
+                DEPENDS ${INPUT_PATH}
+                COMMENT "Compressing ${INPUT_FILE}"
+            )
+        else()
+            set(BLOB_PATH ${INPUT_PATH})
+            set(BLOB_SYMBOL ${SYMBOL})
+        endif()
+
+        # Raw data, with a NUL terminator past the end so text can be used as is
+        set(CODE "\t.section .rodata.${BLOB_SYMBOL}, \"a\", @progbits\n")
+        if(NOT EMBED_COMPRESSED)
+            string(APPEND CODE "\t.global ${BLOB_SYMBOL}\n")
+        endif()
+        string(APPEND CODE
+            "\t.type ${BLOB_SYMBOL}, @object\n"
+            "\t.balign ${EMBED_ALIGN}\n"
+            "${BLOB_SYMBOL}:\n"
+            "\t.incbin \"${BLOB_PATH}\"\n"
+            "${BLOB_SYMBOL}_end:\n"
+            "\t.byte 0\n"
+            "\t.size ${BLOB_SYMBOL}, . - ${BLOB_SYMBOL}\n"
+        )
+
+        if(EMBED_COMPRESSED)
+            # struct embedded_resource, filled in on first access
+            string(APPEND CODE
+                "\t.data\n"
+                "\t.global ${SYMBOL}\n"
+                "\t.type ${SYMBOL}, @object\n"
+                "\t.balign __SIZEOF_POINTER__\n"
+                "${SYMBOL}:\n"
+                "\t.dc.a ${BLOB_SYMBOL}\n"
+                "\t.dc.a 0\n"
+                "\t.int ${BLOB_SYMBOL}_end - ${BLOB_SYMBOL}\n"
+                "\t.int 0\n"
+                "\t.size ${SYMBOL}, . - ${SYMBOL}\n"
+            )
+        else()
+            string(APPEND CODE
+                "\t.global ${SYMBOL}_len\n"
+                "\t.type ${SYMBOL}_len, @object\n"
+                "\t.balign 4\n"
+                "${SYMBOL}_len:\n"
+                "\t.int ${BLOB_SYMBOL}_end - ${BLOB_SYMBOL}\n"
+                "\t.size ${SYMBOL}_len, 4\n"
+            )
+        endif()
+        string(APPEND CODE "\t.section .note.GNU-stack, \"\", @progbits\n")
+
+        # Only touch the stub when it changes, so re-running cmake does not
+        # trigger a rebuild. Resource edits are tracked through OBJECT_DEPENDS.
+        file(WRITE ${OUTPUT_FILE}.tmp ${CODE})
+        configure_file(${OUTPUT_FILE}.tmp ${OUTPUT_FILE} COPYONLY)
+        file(REMOVE ${OUTPUT_FILE}.tmp)
+        set_source_files_properties(${OUTPUT_FILE} PROPERTIES OBJECT_DEPENDS ${BLOB_PATH})
+
+        list(APPEND SOURCES ${OUTPUT_FILE})
+    endforeach()
+
+    if(EMBED_COMPRESSED)
+        list(APPEND SOURCES ${EMBED_RESOURCES_INCLUDE_DIR}/embedded_resource.c)
+        list(REMOVE_DUPLICATES SOURCES)
+    endif()
+    set(${VAR} ${SOURCES} PARENT_SCOPE)
+endfunction()
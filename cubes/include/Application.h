@@ -2,13 +2,31 @@
 #define APPLICATION_H_198BB0AA
 
 #include <atomic>
-#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <GL/gl.h>
+#include <glm/mat4x4.hpp>
 #include "gl/Buffer.h"
+#include "gl/Debug.h"
+#include "gl/Framebuffer.h"
+#include "gl/ProgramCache.h"
+#include "gl/ProgramVariants.h"
 #include "gl/Shader.h"
+#include "gl/State.h"
+#include "gl/StreamBuffer.h"
+#include "gl/UniformBlock.h"
 #include "gl/Vertex.h"
+#include "Culler.h"
+#include "FramePacer.h"
+#include "Mesh.h"
+#include "Profiler.h"
+#include "Recorder.h"
+#include "Scene.h"
+#include "TripleBuffer.h"
+#include "WorkerPool.h"
 
 struct SDL_Window;
 struct SDL_KeyboardEvent;
@@ -23,21 +41,64 @@ template <typename T> using sdl_ptr = std::unique_ptr<T, SDLDeleter<T>>;
 
 class Application final
 {
-    using milliseconds = std::chrono::duration<unsigned, std::milli>;
+public:
+    /// Run-time settings, from the command line
+    struct Options
+    {
+        unsigned    instances = 2;                  ///< Number of cubes to render
+        unsigned    threads = 0;                    ///< Number of threads computing transforms, 0 for auto
+        unsigned    tickRate = 100;                 ///< Simulation steps per second
+        FramePacer::sync vsync = FramePacer::sync::On; ///< How buffer swaps wait for the display
+        unsigned    maxFrameRate = 0;               ///< Frames per second not to exceed, 0 for no limit
+        unsigned    profilePeriod = 0;              ///< Frames between profiler reports, 0 to disable
+        std::string profileFile;                    ///< CSV file to write profiler reports to, if any
+        bool        debug = false;                  ///< Request a debug context, always on in debug builds
+        bool        culling = false;                ///< Cull cubes against the view frustum on the GPU
+        bool        fog = false;                    ///< Fade distant cubes
+        bool        lighting = false;               ///< Shade cubes with a directional light
+        unsigned    benchFrames = 0;                ///< Frames to render offscreen as fast as possible, 0 to run interactively
+        std::string shaderCache;                    ///< Directory to cache program binaries in, if any
+        std::string capturePath;                    ///< File or PNG pattern to record frames to, if any
+        std::string meshPath;                       ///< Mesh file to draw cubes with, see MeshFile.h
+    };
+
 public:
     Application() = delete;
-    explicit Application(std::string name);
+    Application(std::string name, Options);
     ~Application();
 
-    int     run();                                  ///< Main rendering and event loop
+    int     run();                                  ///< Main event and simulation loop
     void    quit();                                 ///< Signal run() it should exit. Thread-safe.
 
 private:
+    /// Snapshot of world state, handed from simulation to render thread. It holds the
+    /// last two simulation states, so rendering can interpolate between them.
+    struct Frame
+    {
+        double          previous = 0.0;             ///< Scene time at second to last tick, in seconds
+        double          current = 0.0;              ///< Scene time at last tick, in seconds
+        std::uint64_t   tickStart = 0;              ///< Performance counter when last tick was due
+        std::uint64_t   input = 0;                  ///< Performance counter when latest input was handled, 0 if none
+        bool            visible = false;            ///< Whether window is visible, so frame must be drawn
+    };
+
     void    init();                                 ///< Post-construction initialization
-    void    update(milliseconds);                   ///< Update world state
-    void    render();                               ///< Render current world state to screen
+    int     benchmark();                            ///< Render a fixed number of frames offscreen, and report timings
+    /// Run renderFrames() on render thread, counting frames. Returns non-zero on failure.
+    int     renderLoop(unsigned long & frames);
+    void    renderFrames(unsigned long & frames);   ///< Render published frames until quit
+    void    advance(std::uint64_t elapsed);         ///< Run ticks of simulation for elapsed counter units
+    void    update();                               ///< Update world state by one tick
+    Frame   snapshot(std::uint64_t now) const;      ///< Get last two states, at given counter value
+    /// Render world state, interpolated between previous and current by alpha in [0, 1]
+    void    render(const Frame &, float alpha);
+    void    stopRecording();                        ///< Flush captured frames and report, if recording
+
+    /// Report rendering errors from debug output, and from glGetError() if poll is set
+    bool    processErrors(const char * ctx, bool poll);
 
-    bool    processErrors(const char *);            ///< Handle rendering errors in other methods
+    /// Point instance attributes at transforms stored in buffer, starting at offset
+    void    setInstanceBuffer(gl::VertexBuffer & buffer, std::size_t offset);
 
     void    onKeyDown(const SDL_KeyboardEvent &);   ///< Called when the user presses a key
     void    onKeyUp(const SDL_KeyboardEvent &);     ///< Called when the user releases a key
@@ -45,20 +106,67 @@ private:
     void    onWindowEvent(const SDL_WindowEvent &); ///< Called on window manager notifications
 
 private:
-    /// Create an OpenGL-enabled window
-    static sdl_ptr<SDL_Window> createWindow(const std::string & name);
+    /// Optional shader features, see shaders for details
+    enum class feature {
+        VertexColor,                                ///< Use per-vertex colors
+        Fog,                                        ///< Fade colors with distance
+        Lighting,                                   ///< Shade with vertex normals
+    };
+
+    /// Create an OpenGL-enabled window, with V-sync unless hidden
+    static sdl_ptr<SDL_Window> createWindow(const std::string & name, bool debug, bool hidden);
 
 private:
+    const Options       m_options;              ///< Settings given at construction
     std::atomic<bool>   m_quit;                 ///< When set, run() will exit
     sdl_ptr<SDL_Window> m_window;               ///< Main application window
+    void *              m_context;              ///< OpenGL context of m_window, an SDL_GLContext
+    gl::StateCache      m_state;                ///< Shadow copy of OpenGL state, for our context
+    gl::DebugLog        m_debugLog;             ///< Messages from OpenGL driver
+
+    Profiler            m_profiler;             ///< Frame timing statistics
+    Profiler::scope_id  m_updateScope;          ///< Profiler scope timing simulation, on main thread
+    Profiler::scope_id  m_renderScope;          ///< Profiler scope timing render() on CPU
+    Profiler::scope_id  m_gpuScope;             ///< Profiler scope timing render() on GPU
+    Profiler::scope_id  m_swapScope;            ///< Profiler scope timing buffer swaps
+    Profiler::scope_id  m_errorsScope;          ///< Profiler scope timing processErrors()
 
-    gl::Program         m_program;              ///< Shader program used for rendering
+    gl::Framebuffer     m_target;               ///< Offscreen render target, when benchmarking
+    gl::ProgramCache    m_programs;             ///< Program binaries saved across runs
+    gl::ProgramVariants<feature> m_programVariants; ///< Shader program for every feature set
+    gl::Features<feature> m_features;           ///< Shader features to render with
+    const gl::Program * m_program = nullptr;    ///< Shader program used for rendering, once compiled
     gl::VertexArray     m_array;                ///< Fully loaded cube vertex array
-    gl::VertexBuffer    m_cube;                 ///< Geometry for a single cube
-    GLint               m_mvpLocation = 0;      ///< Location of mvp uniform variable
+    Mesh                m_cube;                 ///< Geometry for a single cube
+    gl::VertexStreamBuffer m_stream;            ///< Model matrix of every cube, when persistently mapped
+    gl::VertexBuffer    m_instances;            ///< Model matrix of every cube, otherwise
+    gl::DrawIndirectBuffer m_commands;          ///< Draw commands, when multi-draw indirect is supported
+    Culler              m_culler;               ///< GPU frustum culling, when enabled
+    std::unique_ptr<Recorder> m_recorder;       ///< Frame capture, when enabled
+    glm::mat4           m_viewProjection;       ///< Camera transform, from world to screen
+
+    /// Contents of the Camera uniform block of vertex shader
+    struct Camera
+    {
+        gl::std140::mat4    viewProjection;     ///< Transformation from world to screen
+        gl::std140::vec4    positionScale;      ///< Dequantization of mesh positions, see MeshVertex
+        gl::std140::vec4    positionBias;       ///< Dequantization of mesh positions, see MeshVertex
+    };
+    gl::UniformBlock<Camera> m_camera;          ///< Per-frame camera constants
+
+    Scene               m_scene;                ///< All cubes and their animation
+    WorkerPool          m_workers;              ///< Threads computing cube transforms
 
-    unsigned            m_angle = 0;            ///< Current rotation angle for cubes
+    std::uint64_t       m_tickLength = 0;       ///< Duration of a tick, in performance counter units
+    std::uint64_t       m_accumulator = 0;      ///< Time not simulated yet, in performance counter units
+    double              m_time = 0.0;           ///< Scene time at last tick, in seconds
+    double              m_previousTime = 0.0;   ///< Scene time at second to last tick, in seconds
     bool                m_visible = false;      ///< Whether window is currently visible
+    TripleBuffer<Frame> m_frames;               ///< Latest world state, from simulation to render thread
+    std::mutex          m_idleMutex;            ///< Protects render thread going to sleep
+    std::condition_variable m_idleWake;         ///< Wakes render thread when window shows or on quit
+    std::uint64_t       m_lastInput = 0;        ///< Performance counter when latest input was handled
+    FramePacer          m_pacer;                ///< Frame rate cap and latency, used by render thread
 };
 
 /****************************************************************************/
@@ -0,0 +1,87 @@
+#ifndef CULLER_H_5E0D7B94
+#define CULLER_H_5E0D7B94
+
+#include <cstddef>
+#include <glm/mat4x4.hpp>
+#include "gl/Buffer.h"
+#include "gl/ProgramCache.h"
+#include "gl/Shader.h"
+#include "gl/UniformBlock.h"
+#include "gl/Vertex.h"
+
+/****************************************************************************/
+
+/** GPU frustum culling of instances
+ *
+ * A compute shader tests the bounding sphere of every instance against the
+ * view frustum, copies the model matrix of visible ones into a compact buffer,
+ * and counts them into an indirect draw command. Drawing from that command
+ * and buffer renders visible instances only, without the CPU ever looking at
+ * individual objects or waiting for the result.
+ *
+ * Requires OpenGL 4.3, for compute shaders and shader storage buffers.
+ */
+class Culler final
+{
+public:
+    static constexpr GLuint groupSize = 64;         ///< Instances per work group, must match shader
+
+public:
+    Culler() = default;                             ///< Create an invalid culler
+
+    /// Create a culler for up to capacity instances
+    /// @param capacity Maximum number of instances per cull() call
+    /// @param indices Number of indices in the instanced mesh
+    /// @param radius Radius of the mesh bounding sphere, centered on model origin
+    /// @param binding Uniform block binding point to use for culling parameters
+    /// @param programs Cache to get the culling program from
+    Culler(std::size_t capacity, GLuint indices, float radius, GLuint binding,
+           gl::ProgramCache & programs);
+
+    /// Check whether current context can cull on the GPU
+    static bool isSupported();
+    /// Get required alignment of instance buffer offsets in current context, see alignment()
+    static std::size_t offsetAlignment();
+
+    bool        valid() const noexcept              ///< True if culler was created
+        { return m_capacity > 0; }
+
+    /// Get required alignment of instance buffer offsets given to cull()
+    std::size_t alignment() const noexcept { return m_alignment; }
+
+    /// Get buffer receiving model matrices of visible instances, to feed instanced attributes
+    gl::VertexBuffer &          visible() noexcept { return m_visible; }
+    /// Get buffer holding a single indexed draw command, instance count set to visible instances
+    gl::DrawIndirectBuffer &    commands() noexcept { return m_commands; }
+
+    /// Queue culling of instances, leaving results for next draw commands
+    /// @param viewProjection Camera transform, from world to screen
+    /// @param instances Buffer holding model matrix of every instance
+    /// @param offset Location of first matrix in instances, a multiple of alignment()
+    /// @param count Number of instances to cull, at most capacity
+    void        cull(const glm::mat4 & viewProjection, const gl::VertexBuffer & instances,
+                     std::size_t offset, std::size_t count);
+
+private:
+    /// Contents of the Frustum uniform block of cull shader
+    struct Frustum
+    {
+        gl::std140::array<gl::std140::vec4, 6> planes;  ///< Normalized planes, pointing inside
+        GLfloat         radius;                     ///< Radius of instance bounding sphere
+        GLuint          count;                      ///< Number of instances to test
+    };
+
+private:
+    std::size_t         m_capacity = 0;             ///< Maximum number of instances
+    GLuint              m_indices = 0;              ///< Number of indices in the instanced mesh
+    float               m_radius = 0.0f;            ///< Radius of mesh bounding sphere
+    std::size_t         m_alignment = 1;            ///< Shader storage buffer offset alignment
+    gl::Program         m_program;                  ///< Culling compute shader
+    gl::UniformBlock<Frustum> m_frustum;            ///< Culling parameters
+    gl::VertexBuffer    m_visible;                  ///< Model matrices of visible instances
+    gl::DrawIndirectBuffer m_commands;              ///< Draw command for visible instances
+};
+
+/****************************************************************************/
+
+#endif
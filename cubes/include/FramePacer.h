@@ -0,0 +1,74 @@
+#ifndef FRAMEPACER_H_5E09C2B7
+#define FRAMEPACER_H_5E09C2B7
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/****************************************************************************/
+
+/** Frame pacing, setting when frames start and how they meet the display
+ *
+ * Presentation follows one of three V-sync modes. Adaptive V-sync waits for
+ * the display refresh like regular V-sync when frames are on time, but
+ * presents late frames immediately, tearing rather than dropping to half rate.
+ * Drivers lacking it fall back to regular V-sync.
+ *
+ * Frame rate can also be capped, to save power where full rate is not needed.
+ * Sleeping is only accurate to a millisecond or more, so waits sleep until
+ * shortly before the deadline, then spin on the performance counter.
+ *
+ * Last, it measures input-to-present latency: the time from the program
+ * handling an input event to the swap of the first frame showing its effect
+ * returning. That is a lower bound, as the display may scan out later.
+ */
+class FramePacer final
+{
+public:
+    /// How buffer swaps wait for the display
+    enum class sync {
+        Off,                                        ///< Never wait, tearing
+        On,                                         ///< Wait for next refresh
+        Adaptive,                                   ///< Wait for next refresh, unless already late
+    };
+
+    /// Latency statistics, in milliseconds
+    struct Latency
+    {
+        unsigned long   count;                      ///< Number of inputs measured since creation
+        float           mean;                       ///< Mean latency over recent inputs
+        float           p95;                        ///< 95th percentile latency over recent inputs
+    };
+
+    static constexpr std::size_t latencySamples = 1024; ///< Recent inputs statistics are computed over
+
+public:
+    FramePacer() = default;                         ///< Create a pacer that does nothing
+    /// Set V-sync mode of current context, and cap frame rate to maxRate, unless 0.
+    /// Falls back to regular V-sync if adaptive V-sync is not supported.
+    FramePacer(sync mode, unsigned maxRate);
+
+    sync        mode() const noexcept { return m_mode; }  ///< Get V-sync mode actually in use
+
+    /// Wait until next frame is due, if frame rate is capped
+    void        waitFrame();
+    /// Record that a frame was presented, showing the effect of input handled at given
+    /// performance counter value, or 0 if none. Each input value is only measured once.
+    void        presented(std::uint64_t input);
+    /// Get input-to-present latency statistics
+    Latency     latency() const;
+
+private:
+    sync                m_mode = sync::Off;         ///< V-sync mode in use
+    std::uint64_t       m_period = 0;               ///< Minimum time between frames, in counter units, 0 if uncapped
+    std::uint64_t       m_spin = 0;                 ///< Time spent spinning before a deadline, in counter units
+    std::uint64_t       m_deadline = 0;             ///< Time next frame is due, in counter units
+
+    std::uint64_t       m_lastInput = 0;            ///< Input time measured last, to only measure it once
+    std::vector<float>  m_latencies;                ///< Ring of recent latencies, in milliseconds
+    unsigned long       m_inputs = 0;               ///< Number of inputs measured
+};
+
+/****************************************************************************/
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef MESH_H_E27A4C09
+#define MESH_H_E27A4C09
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "gl/Buffer.h"
+#include "gl/common.h"
+
+/****************************************************************************/
+
+/** Indexed triangle mesh, laid out for the GPU vertex pipeline
+ *
+ * Meshes usually come as triangle soups, listing every corner of every
+ * triangle, so the GPU fetches and shades shared vertices once per triangle.
+ * Building a mesh merges identical corners into unique vertices referenced
+ * by an index buffer, then:
+ *  - reorders triangles so vertices are mostly found in the post-transform
+ *    cache, using the Tipsify algorithm (Sander, Nehab & Barczak, 2007).
+ *  - reorders vertices by first use, so fetching them walks memory forward.
+ *
+ * All of that is done at build time by the meshconv tool, which also
+ * quantizes positions and narrows indices to the smallest type that holds
+ * them. load() maps its output and uploads it as is, see MeshFile.h.
+ */
+class Mesh final
+{
+public:
+    static constexpr unsigned cacheSize = 16;       ///< Post-transform cache entries optimizations assume
+
+    /// Mesh contents, on the CPU side
+    template <typename V> struct Data
+    {
+        std::vector<V>      vertices;               ///< Unique vertices
+        std::vector<GLuint> indices;                ///< Three vertex indices per triangle
+    };
+
+public:
+    /// Index a triangle soup, merging corners that are identical byte for byte.
+    /// Padding takes part in comparisons, so V should make it explicit and zero it.
+    template <typename V> static Data<V> index(const V * corners, std::size_t count);
+
+    /// Reorder triangles for post-transform cache hits, in linear time
+    static void     optimizeVertexCache(std::vector<GLuint> & indices, std::size_t vertexCount);
+
+    /// Reorder vertices in order of first use by indices, dropping unused ones
+    template <typename V> static void optimizeVertexFetch(Data<V> & data);
+
+    /// Get average number of vertices transformed per triangle, simulating a FIFO
+    /// cache of cacheSize entries. Ranges from 3 down to about 0.5 for regular grids.
+    static float    cacheMissRatio(const std::vector<GLuint> & indices, std::size_t vertexCount);
+
+    /// Index a triangle soup, and apply all optimizations
+    template <typename V> static Data<V> build(const V * corners, std::size_t count)
+    {
+        auto data = index(corners, count);
+        optimizeVertexCache(data.indices, data.vertices.size());
+        optimizeVertexFetch(data);
+        return data;
+    }
+
+public:
+    Mesh() = default;                               ///< Create an empty mesh
+
+    Mesh(Mesh &&) = default;
+    Mesh & operator=(Mesh &&) = default;
+
+    /// Load a mesh file, mapping it and uploading its blocks without any conversion.
+    /// Vertices are laid out as MeshVertex.
+    /// @throw std::runtime_error if file cannot be read, or is not a valid mesh file
+    static Mesh load(const std::string & path);
+
+    bool        valid() const noexcept              ///< True if mesh was uploaded
+        { return m_indexCount > 0; }
+    gl::VertexBuffer & vertices() noexcept          ///< Get vertex buffer, to set up attributes
+        { return m_vertices; }
+    gl::type    indexType() const noexcept          ///< Get type of indices, for draw calls
+        { return m_indexType; }
+    GLuint      indexCount() const noexcept         ///< Get number of indices, three per triangle
+        { return m_indexCount; }
+    GLuint      vertexCount() const noexcept        ///< Get number of unique vertices
+        { return m_vertexCount; }
+    float       radius() const noexcept             ///< Get bounding sphere radius
+        { return m_radius; }
+    const float * positionScale() const noexcept    ///< Get scale turning quantized positions into model coordinates, w is 0
+        { return m_positionScale; }
+    const float * positionBias() const noexcept     ///< Get bias turning quantized positions into model coordinates, w is 1
+        { return m_positionBias; }
+
+    /// Attach index buffer to currently bound vertex array
+    void        bindIndices() const { m_indices.bind(); }
+
+private:
+    /// Hash raw bytes of a vertex
+    static std::size_t hash(const void * data, std::size_t size);
+    /// Renumber vertices in order of first use, returning the new index of every
+    /// former vertex, or invalid for unused ones, and their count in used
+    static std::vector<GLuint> fetchOrder(std::vector<GLuint> & indices, std::size_t vertexCount,
+                                          std::size_t & used);
+
+    static constexpr GLuint invalid = ~GLuint(0);   ///< Marks empty slots and unused vertices
+
+private:
+    gl::VertexBuffer    m_vertices;                 ///< Unique vertices
+    gl::ElementBuffer   m_indices;                  ///< Three indices per triangle
+    gl::type            m_indexType = gl::type::UInt; ///< Type of indices in m_indices
+    GLuint              m_indexCount = 0;           ///< Number of indices
+    GLuint              m_vertexCount = 0;          ///< Number of vertices
+    float               m_radius = 0.0f;            ///< Bounding sphere radius, centered on origin
+    float               m_positionScale[4] = { 1.0f, 1.0f, 1.0f, 0.0f }; ///< Dequantization scale, see MeshVertex
+    float               m_positionBias[4] = { 0.0f, 0.0f, 0.0f, 1.0f };  ///< Dequantization bias, see MeshVertex
+};
+
+/****************************************************************************/
+
+template <typename V> Mesh::Data<V> Mesh::index(const V * corners, std::size_t count)
+{
+    static_assert(std::is_trivially_copyable<V>::value, "vertices are compared as raw bytes");
+
+    // Open addressing table of vertex indices, at most half full
+    std::size_t tableSize = 16;
+    while (tableSize < count * 2) { tableSize *= 2; }
+    std::vector<GLuint> table(tableSize, invalid);
+
+    Data<V> data;
+    data.indices.reserve(count);
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        const auto & corner = corners[idx];
+        auto slot = hash(&corner, sizeof(V)) & (tableSize - 1);
+        while (table[slot] != invalid
+               && std::memcmp(&data.vertices[table[slot]], &corner, sizeof(V)) != 0) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] == invalid) {
+            table[slot] = GLuint(data.vertices.size());
+            data.vertices.push_back(corner);
+        }
+        data.indices.push_back(table[slot]);
+    }
+    return data;
+}
+
+template <typename V> void Mesh::optimizeVertexFetch(Data<V> & data)
+{
+    std::size_t used;
+    const auto order = fetchOrder(data.indices, data.vertices.size(), used);
+    std::vector<V> vertices(used);
+    for (std::size_t idx = 0; idx < order.size(); ++idx) {
+        if (order[idx] != invalid) { vertices[order[idx]] = data.vertices[idx]; }
+    }
+    data.vertices = std::move(vertices);
+}
+
+/****************************************************************************/
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef MESHFILE_H_4B7D19F3
+#define MESHFILE_H_4B7D19F3
+
+#include <cstdint>
+#include <type_traits>
+
+/****************************************************************************/
+
+/** Binary mesh file format
+ *
+ * Mesh files are produced at build time by the meshconv tool, from OBJ or PLY
+ * sources, and hold data exactly as GPU buffers expect it: a header, followed
+ * by a block of vertices and a block of indices, each starting on an aligned
+ * offset. Loading maps the file and hands both blocks to the driver as they
+ * are, without any parsing or conversion.
+ *
+ * Values are stored in host byte order, which is little endian on every
+ * platform we target. Files with another version are rejected, so any
+ * change to this layout must bump meshFileVersion.
+ */
+
+static constexpr char meshFileMagic[4] = { 'M', 'E', 'S', 'H' };
+static constexpr std::uint32_t meshFileVersion = 2;    ///< Current version of the format
+static constexpr std::uint64_t meshFileAlignment = 16; ///< Alignment of blocks, from start of file
+
+/// Header at start of mesh files
+struct MeshFileHeader
+{
+    char            magic[4];                       ///< Always meshFileMagic
+    std::uint32_t   version;                        ///< Always meshFileVersion
+    std::uint32_t   vertexSize;                     ///< Size of a vertex, checked against MeshVertex
+    std::uint32_t   vertexCount;                    ///< Number of vertices
+    std::uint32_t   indexSize;                      ///< Size of an index, 2 or 4 bytes
+    std::uint32_t   indexCount;                     ///< Number of indices, three per triangle
+    std::uint64_t   vertexOffset;                   ///< Start of vertex block, from start of file
+    std::uint64_t   indexOffset;                    ///< Start of index block, from start of file
+    float           radius;                         ///< Radius of bounding sphere, centered on origin
+    float           positionScale[3];               ///< Half size of bounding box, see MeshVertex
+    float           positionBias[3];                ///< Center of bounding box, see MeshVertex
+    std::uint32_t   reserved;                       ///< Zero
+};
+
+/// Vertex layout in mesh files.
+/// Positions are quantized over the bounding box of the mesh: each coordinate is
+/// stored as a signed normalized 16-bit value, mapping [-1, 1] onto the box. Model
+/// coordinates are position / 32767 * positionScale + positionBias, which vertex
+/// fetch and the vertex shader compute.
+struct MeshVertex
+{
+    std::int16_t    position[4];                    ///< Quantized coordinates, w is zero
+    std::uint32_t   normal;                         ///< Unit normal, signed normalized 2:10:10:10
+    std::uint8_t    color[4];                       ///< RGBA8
+};
+
+static_assert(sizeof(MeshFileHeader) == 72, "mesh file header must not have padding");
+static_assert(sizeof(MeshVertex) == 16, "mesh vertex must not have padding");
+// Attributes are set up with offsetof(), which needs a standard layout
+static_assert(std::is_standard_layout<MeshVertex>::value, "mesh vertex must have standard layout");
+
+/****************************************************************************/
+
+#endif
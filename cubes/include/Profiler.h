@@ -0,0 +1,130 @@
+#ifndef PROFILER_H_A4E06B1F
+#define PROFILER_H_A4E06B1F
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "gl/Query.h"
+
+/****************************************************************************/
+
+/** Frame profiler, timing named scopes on both CPU and GPU
+ *
+ * CPU scopes are timed with a steady clock. GPU scopes are timed with
+ * GL_TIME_ELAPSED queries, and the end of every frame is stamped with
+ * glQueryCounter, giving the time the GPU actually spends per frame.
+ *
+ * GPU results are only read back several frames after being issued, by which
+ * time they are available, so profiling never stalls the pipeline. Queries
+ * are kept in a ring of per-frame pools, and reused.
+ *
+ * Every period frames, percentiles of every scope are printed to stderr, and
+ * optionally appended to a CSV file. Each frame is also classified as GPU-bound
+ * if GPU time exceeds CPU work, that is CPU time not spent waiting.
+ *
+ * Only Background scopes may be timed from other threads than the one
+ * calling endFrame(). All scopes must be added before that.
+ */
+class Profiler final
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using scope_id = unsigned;
+    static constexpr unsigned latency = 4;          ///< Frames between issuing and reading GPU queries
+
+    /// What a scope measures
+    enum class kind {
+        Work,                                       ///< CPU time doing useful work
+        Wait,                                       ///< CPU time blocked on something else, eg: V-sync
+        Gpu,                                        ///< GPU time. GPU scopes cannot nest.
+        Background,                                 ///< CPU time on another thread, eg: simulation.
+                                                    ///< Safe to time from any thread, not frame work.
+    };
+
+    /// Scoped timer, measuring from construction to destruction
+    class Timer final
+    {
+    public:
+        Timer(Profiler & profiler, scope_id id);
+        Timer(const Timer &) = delete;
+        ~Timer();
+    private:
+        Profiler *          m_profiler;             ///< Owning profiler, nullptr if disabled
+        scope_id            m_id;                   ///< Scope being timed
+        clock::time_point   m_start;                ///< Time of construction, for CPU scopes
+    };
+
+public:
+    /// Create a profiler reporting every period frames, also to csvPath if not empty.
+    /// Requires a current OpenGL context, unless period is 0, which disables profiling.
+    Profiler(unsigned period, const std::string & csvPath);
+    Profiler(const Profiler &) = delete;
+    Profiler & operator=(const Profiler &) = delete;
+
+    bool        enabled() const noexcept            ///< True if profiler actually measures anything
+        { return m_period != 0; }
+
+    /// Register a new scope
+    scope_id    addScope(std::string name, kind);
+    /// Start timing a scope until returned object goes away
+    Timer       time(scope_id id) { return Timer(*this, id); }
+    /// Mark end of frame, collecting results and reporting if period elapsed
+    void        endFrame();
+
+private:
+    /// A GPU query waiting for its result
+    struct GpuSample
+    {
+        scope_id            id;                     ///< Scope query measures
+        gl::Query           query;                  ///< TIME_ELAPSED query
+    };
+
+    /// Measures issued during one frame
+    struct Frame
+    {
+        std::vector<GpuSample> samples;             ///< GPU query pool, grown as needed
+        std::size_t         used = 0;               ///< Number of samples in use
+        gl::Query           end;                    ///< Timestamp of end of frame
+        bool                pending = false;        ///< True if end was issued, and not read yet
+        float               work = 0.0f;            ///< CPU work time, in milliseconds
+    };
+
+    /// Statistics of a scope
+    struct Scope
+    {
+        std::string         name;                   ///< Name shown in reports
+        kind                type;                   ///< What scope measures
+        std::vector<float>  samples;                ///< Durations since last report, in milliseconds
+    };
+
+    void        start(scope_id id);                 ///< Start measuring a GPU scope
+    void        stop(scope_id id, clock::time_point start); ///< Stop measuring a scope
+    void        collect(Frame &);                   ///< Read back GPU results of a frame
+    void        report();                           ///< Print and reset statistics
+
+private:
+    unsigned            m_period = 0;               ///< Frames between reports, 0 if disabled
+    std::ofstream       m_csv;                      ///< Report output, if any
+    std::vector<Scope>  m_scopes;                   ///< All scopes
+    std::vector<Frame>  m_frames;                   ///< Ring of latency frames
+    unsigned            m_frame = 0;                ///< Index of current frame in ring
+    float               m_work = 0.0f;              ///< CPU work time in current frame
+
+    scope_id            m_cpuFrame = 0;             ///< Built-in scope measuring CPU frame time
+    scope_id            m_gpuFrame = 0;             ///< Built-in scope measuring GPU frame time
+    clock::time_point   m_lastFrame;                ///< Time of last endFrame() call
+    GLuint64            m_lastGpuFrame = 0;         ///< GPU timestamp of last collected frame
+
+    unsigned long       m_frameCount = 0;           ///< Total number of frames
+    unsigned            m_gpuBound = 0;             ///< GPU-bound frames since last report
+    unsigned            m_collected = 0;            ///< Frames with GPU results since last report
+    unsigned            m_dropped = 0;              ///< Frames whose results were late
+
+    std::mutex          m_mutex;                    ///< Protects samples of Background scopes
+};
+
+/****************************************************************************/
+
+#endif
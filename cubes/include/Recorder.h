@@ -0,0 +1,105 @@
+#ifndef RECORDER_H_3F9C62DA
+#define RECORDER_H_3F9C62DA
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gl/PixelReadback.h"
+
+/****************************************************************************/
+
+/** Frame capture to image files or raw video, without stalling rendering
+ *
+ * Frames are copied into a ring of pixel pack buffers on the GPU, and only
+ * mapped a few frames later, once the copy completed. Pixels are then handed
+ * to a background thread for encoding and writing, so the render loop waits
+ * neither on the GPU, on compression nor on the disk.
+ *
+ * If path ends with `.png`, every frame is written as an RGB PNG image, the
+ * last run of `#` characters in path being replaced with the zero-padded frame
+ * number. Otherwise, frames are appended to path as raw video, 4 bytes per
+ * pixel, top row first, which eg: ffmpeg reads with `-f rawvideo -pix_fmt rgb0`.
+ * The fourth byte is padding, as the window has no alpha channel.
+ *
+ * When the encoder falls behind, frames are dropped rather than piling up in
+ * memory. PNG frame numbers keep counting, so dropped frames show as gaps.
+ */
+class Recorder final
+{
+public:
+    /// Output formats
+    enum class format {
+        Png,                                        ///< One PNG image per frame
+        Raw,                                        ///< Single stream of raw frames, 4 bytes per pixel
+    };
+
+    /// Capture statistics
+    struct Counters
+    {
+        unsigned long   captured = 0;               ///< Frames read back from the GPU
+        unsigned long   written = 0;                ///< Frames encoded and written
+        unsigned long   dropped = 0;                ///< Frames lost because the encoder was behind or failed
+        unsigned        stalls = 0;                 ///< Times the render loop waited on a readback
+    };
+
+public:
+    /// Start recording width x height frames to path. Requires a current OpenGL context.
+    /// @param queue Maximum number of frames waiting for the encoder
+    /// @throw std::runtime_error if raw output file cannot be opened
+    Recorder(std::string path, GLsizei width, GLsizei height, unsigned queue = 8);
+    Recorder(const Recorder &) = delete;
+    ~Recorder();
+
+    Recorder & operator=(const Recorder &) = delete;
+
+    format      type() const noexcept { return m_format; }
+    Counters    counters() const;                   ///< Get capture statistics. Thread-safe.
+
+    /// Queue capture of current read framebuffer, collecting completed earlier captures
+    void        capture();
+    /// Wait for all captures to be read back, encoded and written, and stop the encoder
+    void        finish();
+
+private:
+    /// A frame waiting for the encoder
+    struct Frame
+    {
+        unsigned long   number;                     ///< Frame number, counting dropped ones
+        std::vector<unsigned char> pixels;          ///< RGBA8 pixels, bottom row first
+    };
+
+    void        collect(const unsigned char * pixels); ///< Hand pixels of a readback to the encoder
+    void        threadMain();                       ///< Entry point of encoder thread
+    bool        encode(const Frame &);              ///< Write a frame, returning false on failure
+    bool        writePng(const Frame &);            ///< Write a frame to its own PNG file
+    std::string framePath(unsigned long number) const; ///< Get path of PNG file for a frame
+
+private:
+    const std::string   m_path;                     ///< Output path, or pattern for PNG files
+    const format        m_format;                   ///< Output format, from path
+    gl::PixelReadback   m_readback;                 ///< Ring of pending GPU readbacks
+    unsigned long       m_next = 0;                 ///< Number of next frame read back
+    std::ofstream       m_raw;                      ///< Output stream, for raw video
+
+    mutable std::mutex  m_mutex;                    ///< Protects members below
+    std::condition_variable m_wake;                 ///< Signaled when a frame is queued or encoder stops
+    std::deque<Frame>   m_queue;                    ///< Frames waiting for the encoder
+    std::vector<std::vector<unsigned char>> m_free; ///< Pixel buffers available for reuse
+    unsigned            m_buffers = 0;              ///< Number of pixel buffers allocated so far
+    const unsigned      m_capacity;                 ///< Maximum number of pixel buffers
+    Counters            m_counters;                 ///< Capture statistics
+    bool                m_stop = false;             ///< When set, encoder exits once queue is empty
+    bool                m_failed = false;           ///< Set after a write failure, dropping further frames
+
+    std::vector<unsigned char> m_scanlines;         ///< Encoder scratch space for PNG filtering
+    std::vector<unsigned char> m_compressed;        ///< Encoder scratch space for PNG compression
+    std::thread         m_thread;                   ///< Encoder thread, last so it starts after the rest
+};
+
+/****************************************************************************/
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SCENE_H_83C1E5A7
+#define SCENE_H_83C1E5A7
+
+#include <cstddef>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+class WorkerPool;
+
+/****************************************************************************/
+
+/** Store of all animated objects, laid out as a structure of arrays
+ *
+ * Every object sits at a fixed position, spins around the vertical axis and
+ * tumbles around an axis of its own, both at constant speeds. Each property
+ * is kept in its own array, so transforms are computed for several objects
+ * at once, one per SIMD lane, with plain vector loads.
+ */
+class Scene final
+{
+public:
+#ifdef __AVX__
+    static constexpr std::size_t lanes = 8;         ///< Number of objects in a SIMD batch
+#else
+    static constexpr std::size_t lanes = 4;         ///< Number of objects in a SIMD batch
+#endif
+    static constexpr std::size_t grain = 1024;      ///< Number of objects in a job chunk
+
+public:
+    Scene() = default;
+
+    std::size_t size() const noexcept               ///< Get number of objects
+        { return m_count; }
+
+    /// Allocate memory for count objects
+    void        reserve(std::size_t count);
+
+    /// Add an object to the scene
+    /// @param position World position of the object's center
+    /// @param spin Rotation speed around vertical axis, in radians per second
+    /// @param axis Unit vector the object tumbles around
+    /// @param tumble Rotation speed around axis, in radians per second
+    void        add(const glm::vec3 & position, float spin, const glm::vec3 & axis, float tumble);
+
+    /// Compute model matrix of every object at given time, splitting work across a pool
+    /// @param time Animation time, in seconds
+    /// @param out Destination of size() matrices, eg: a mapped instance buffer
+    /// @param pool Threads to compute matrices on
+    void        computeTransforms(float time, glm::mat4 * out, WorkerPool & pool) const;
+
+private:
+    /// Compute model matrices of objects in [begin, end), begin being a multiple of lanes
+    void        computeRange(float time, std::size_t begin, std::size_t end,
+                             glm::mat4 * out) const;
+
+private:
+    std::size_t         m_count = 0;                ///< Number of objects
+    // Arrays are padded to a multiple of lanes, so batches never go out of bounds
+    std::vector<float>  m_x, m_y, m_z;              ///< Position of every object
+    std::vector<float>  m_spin;                     ///< Speed around vertical axis
+    std::vector<float>  m_axisX, m_axisY, m_axisZ;  ///< Tumbling axis of every object
+    std::vector<float>  m_tumble;                   ///< Speed around tumbling axis
+};
+
+/****************************************************************************/
+
+#endif
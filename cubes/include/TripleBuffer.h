@@ -0,0 +1,62 @@
+#ifndef TRIPLEBUFFER_H_3D8C5A71
+#define TRIPLEBUFFER_H_3D8C5A71
+
+#include <atomic>
+
+/****************************************************************************/
+
+/** Lock-free handoff of the latest value from one thread to another
+ *
+ * The producer fills a back slot, then publishes it by swapping it with a
+ * middle slot. The consumer swaps the middle slot with its front slot when
+ * something new was published, and reads from there. Both swaps are a single
+ * atomic exchange, so neither side ever waits on the other: a producer running
+ * faster overwrites values nobody read, and a slower one leaves the consumer
+ * with the last value it got.
+ *
+ * Exactly one thread may call back() and publish(), and exactly one other
+ * thread may call acquire() and front().
+ */
+template <typename T> class TripleBuffer final
+{
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer & operator=(const TripleBuffer &) = delete;
+
+    /// Get slot to fill with next value. Producer only.
+    T &         back() noexcept { return m_slots[m_back].value; }
+    /// Hand back slot over to consumer, replacing any value it did not take yet. Producer only.
+    void        publish() noexcept
+    {
+        m_back = m_middle.exchange(m_back | fresh, std::memory_order_acq_rel) & index;
+    }
+
+    /// Take latest published value into front slot, returning false if there was none
+    /// since last call, leaving front slot as it was. Consumer only.
+    bool        acquire() noexcept
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & fresh) == 0) { return false; }
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & index;
+        return true;
+    }
+    /// Get value taken by last successful acquire(), or a default value. Consumer only.
+    const T &   front() const noexcept { return m_slots[m_front].value; }
+
+private:
+    static constexpr unsigned index = 0x3;          ///< Bits of m_middle holding slot index
+    static constexpr unsigned fresh = 0x4;          ///< Bit of m_middle set if it was never acquired
+
+    /// A slot, on its own cache line so both threads do not keep stealing it from each other
+    struct alignas(64) Slot { T value{}; };
+
+private:
+    Slot                    m_slots[3];             ///< Storage for values
+    alignas(64) std::atomic<unsigned> m_middle{1};  ///< Index of slot being handed over, and fresh bit
+    alignas(64) unsigned    m_back = 0;             ///< Index of producer's slot
+    alignas(64) unsigned    m_front = 2;            ///< Index of consumer's slot
+};
+
+/****************************************************************************/
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef WORKERPOOL_H_6B2F90D4
+#define WORKERPOOL_H_6B2F90D4
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/****************************************************************************/
+
+/** Fixed set of threads splitting data-parallel loops between them
+ *
+ * Threads are started once and sleep between jobs. A job is a range of
+ * indices, cut into chunks that threads grab in turn until none is left,
+ * so uneven chunks balance out. The calling thread takes part in the job,
+ * and run() returns once the whole range was processed.
+ */
+class WorkerPool final
+{
+public:
+    /// Function processing indices in [begin, end)
+    using task = std::function<void(std::size_t begin, std::size_t end)>;
+
+public:
+    /// Start a pool running on given number of threads, including the caller's. 0 means one per core.
+    explicit WorkerPool(unsigned threads = 0);
+    WorkerPool(const WorkerPool &) = delete;
+    ~WorkerPool();
+
+    WorkerPool & operator=(const WorkerPool &) = delete;
+
+    /// Get number of threads working on jobs, including the caller's
+    unsigned    size() const noexcept { return unsigned(m_threads.size()) + 1; }
+
+    /// Run fn over [0, count) in chunks of grain indices, and wait for completion
+    void        run(std::size_t count, std::size_t grain, const task & fn);
+
+private:
+    void        work();                             ///< Process chunks until job is done
+    void        threadMain();                       ///< Entry point of worker threads
+
+private:
+    std::vector<std::thread>    m_threads;          ///< Worker threads, not including caller
+    std::mutex                  m_mutex;            ///< Protects job state below
+    std::condition_variable     m_wake;             ///< Signaled when a job starts or pool stops
+    std::condition_variable     m_done;             ///< Signaled when last worker leaves a job
+
+    const task *                m_task = nullptr;   ///< Current job
+    std::size_t                 m_count = 0;        ///< Number of indices in current job
+    std::size_t                 m_grain = 1;        ///< Number of indices per chunk
+    std::atomic<std::size_t>    m_next{0};          ///< First index of next chunk to process
+    unsigned                    m_generation = 0;   ///< Incremented for every job
+    unsigned                    m_busy = 0;         ///< Number of workers still on current job
+    bool                        m_stop = false;     ///< When set, threads exit
+};
+
+/****************************************************************************/
+
+#endif
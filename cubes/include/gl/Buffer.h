@@ -4,6 +4,7 @@
 #include <cassert>
 #include <utility>
 #include "gl/common.h"
+#include "gl/State.h"
 
 namespace gl {
 
@@ -15,8 +16,10 @@ enum class target {
     ElementArray = GL_ELEMENT_ARRAY_BUFFER,             ///< Array of indices into vertices
     PixelPack = GL_PIXEL_PACK_BUFFER,                   ///< Pixel read buffer
     PixelUnpack = GL_PIXEL_UNPACK_BUFFER,               ///< Texture data source
+    ShaderStorage = GL_SHADER_STORAGE_BUFFER,           ///< Data read and written by shaders
     CopyRead = GL_COPY_READ_BUFFER,                     ///< Source of raw data copy
     CopyWrite = GL_COPY_WRITE_BUFFER,                   ///< Target of raw data copy
+    DrawIndirect = GL_DRAW_INDIRECT_BUFFER,             ///< Parameters of indirect draw calls
     TransformFeedback = GL_TRANSFORM_FEEDBACK_BUFFER,   ///< Feedback data from transformations
     Texture = GL_TEXTURE_BUFFER,                        ///< Pixel data for texturing
     Uniform = GL_UNIFORM_BUFFER                         ///< Uniform data for shader use
@@ -31,6 +34,9 @@ enum class target {
  * That is, as most one buffer of each type may be bound at any time, and binding
  * another buffer of the same type simply unbinds the previous one.
  *
+ * Bindings go through the StateCache of current context, so binding an
+ * already bound buffer costs no OpenGL call.
+ *
  * When compiled in debug mode, all methods will assert this object really is
  * the currently bound buffer for the relevant target. Those checks are removed
  * if NDEBUG is defined.
@@ -84,6 +90,7 @@ public:
     {
         if (m_id == invalid_id) { return; }
         glDeleteBuffers(1, &m_id);
+        StateCache::current().forgetBuffer(m_id);
         m_id = invalid_id;
     }
 
@@ -98,14 +105,14 @@ public:
     /// Discard data
     void setData(std::nullptr_t)
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         glBufferData(static_cast<GLenum>(Target), m_size, nullptr, GL_DYNAMIC_DRAW);
     }
 
     /// Discard data and resize buffer
     void setData(std::nullptr_t, std::size_t size)
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         m_size = size;
         glBufferData(static_cast<GLenum>(Target), size, nullptr, GL_DYNAMIC_DRAW);
     }
@@ -113,7 +120,7 @@ public:
     /// Initialize a new data area from a raw buffer
     void setData(const void * ptr, std::size_t size, usage u)
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         m_size = size;
         glBufferData(static_cast<GLenum>(Target), GLsizeiptr(size), ptr, static_cast<GLenum>(u));
     }
@@ -127,9 +134,9 @@ public:
     /// Update data from a raw buffer
     void setData(const void * ptr, std::size_t size, std::size_t offset)
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         assert(offset + size <= m_size);
-        glBufferSubData(static_cast<GLenum>(Target), offset, size, ptr);
+        glBufferSubData(static_cast<GLenum>(Target), GLintptr(offset), GLsizeiptr(size), ptr);
     }
 
     /// Update data from a container type
@@ -138,22 +145,65 @@ public:
         setData(data.data(), data.size() * sizeof(typename T::value_type), offset);
     }
 
+    /// Allocate immutable storage, optionally initialized from a raw buffer.
+    /// Requires OpenGL 4.4 or ARB_buffer_storage.
+    void setStorage(const void * ptr, std::size_t size, GLbitfield flags)
+    {
+        assert(isBound());
+        m_size = size;
+        glBufferStorage(static_cast<GLenum>(Target), GLsizeiptr(size), ptr, flags);
+    }
+
+    /// Map a range of the buffer into client memory
+    void * map(std::size_t offset, std::size_t size, GLbitfield access)
+    {
+        assert(isBound());
+        assert(offset + size <= m_size);
+        auto ptr = glMapBufferRange(static_cast<GLenum>(Target),
+                                    GLintptr(offset), GLsizeiptr(size), access);
+        if (ptr == nullptr) { throw gl::error("glMapBufferRange failed"); }
+        return ptr;
+    }
+
+    /// Unmap buffer from client memory
+    /// @return false if buffer contents were corrupted while it was mapped
+    bool unmap()
+    {
+        assert(isBound());
+        return glUnmapBuffer(static_cast<GLenum>(Target)) == GL_TRUE;
+    }
+
     /// Bind buffer, enabling the use of other methods
     void bind() const {
-        if (s_bound == m_id) { return; }
-        glBindBuffer(static_cast<GLenum>(Target), m_id);
-        s_bound = m_id;
+        StateCache::current().bindBuffer(static_cast<GLenum>(Target), m_id);
     }
 
     /// Unbind buffer, leaving no active bound buffer
     static void unbind() {
-        if (s_bound == invalid_id) { return; }
-        glBindBuffer(static_cast<GLenum>(Target), invalid_id);
-        s_bound = invalid_id;
+        StateCache::current().bindBuffer(static_cast<GLenum>(Target), invalid_id);
     }
 
     /// Get id of currently bound OpenGL buffer
-    static id_type bound() noexcept { return s_bound; }
+    static id_type bound() { return StateCache::current().buffer(static_cast<GLenum>(Target)); }
+
+    /// Check whether this buffer is currently bound
+    bool isBound() const { return bound() == m_id; }
+
+    /// Bind a range of the buffer to an indexed binding point, for indexed targets only.
+    /// This also binds the whole buffer to the target.
+    void bindRange(GLuint index, std::size_t offset, std::size_t size) const
+    {
+        StateCache::current().bindBufferRange(static_cast<GLenum>(Target), index, m_id,
+                                              GLintptr(offset), GLsizeiptr(size));
+    }
+
+    /// Bind a range of the buffer to an indexed binding point of another target.
+    /// OpenGL buffers are untyped, so eg: a vertex buffer may be written by a compute shader.
+    void bindRange(target other, GLuint index, std::size_t offset, std::size_t size) const
+    {
+        StateCache::current().bindBufferRange(static_cast<GLenum>(other), index, m_id,
+                                              GLintptr(offset), GLsizeiptr(size));
+    }
 
     /// Swap this buffer with another
     void swap(Buffer & rhs) noexcept
@@ -165,8 +215,6 @@ public:
 private:
     id_type     m_id = invalid_id;  ///< OpenGL buffer identifier
     std::size_t m_size = 0;         ///< Size of buffer in bytes
-
-    static id_type s_bound;         ///< Identifier of buffer that is currently bound
 };
 
 /// Swap two buffers, enabling ADL semantics
@@ -176,15 +224,16 @@ template <target Target> void swap(Buffer<Target> & lhs, Buffer<Target> & rhs) n
 }
 
 template <target Target> constexpr typename Buffer<Target>::id_type Buffer<Target>::invalid_id;
-template <target Target> typename Buffer<Target>::id_type Buffer<Target>::s_bound = invalid_id;
 
 /****************************************************************************/
 
 // Convenient aliases for all targets
 typedef Buffer<target::Array> VertexBuffer;
 typedef Buffer<target::ElementArray> ElementBuffer;
+typedef Buffer<target::DrawIndirect> DrawIndirectBuffer;
 typedef Buffer<target::PixelPack> PixelPackBuffer;
 typedef Buffer<target::PixelUnpack> PixelUnpackBuffer;
+typedef Buffer<target::ShaderStorage> ShaderStorageBuffer;
 typedef Buffer<target::TransformFeedback> TransformFeedbackBuffer;
 typedef Buffer<target::Texture> TextureBuffer;
 typedef Buffer<target::Uniform> UniformBuffer;
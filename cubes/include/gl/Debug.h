@@ -0,0 +1,85 @@
+#ifndef DEBUG_H_27B5F0E8
+#define DEBUG_H_27B5F0E8
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include "gl/common.h"
+
+namespace gl {
+
+/****************************************************************************/
+
+/** Collector of messages emitted by the OpenGL driver through KHR_debug
+ *
+ * Registers a callback that the driver invokes whenever it has something to
+ * report, be it an error, a performance warning or a deprecation notice.
+ * Unlike polling glGetError(), this does not force the CPU to wait for the
+ * driver, and it tells what went wrong in plain words.
+ *
+ * Callbacks run asynchronously, possibly from driver threads, so messages are
+ * buffered until take() is called. Only one log may exist per context.
+ *
+ * Drivers only report everything on a debug context, others may only report
+ * errors or nothing at all.
+ *
+ * Requires OpenGL 4.3 or KHR_debug.
+ */
+class DebugLog final
+{
+public:
+    static constexpr std::size_t capacity = 1024;   ///< Maximum number of buffered messages
+
+    /// A single driver message
+    struct Message
+    {
+        GLenum          source;                     ///< Part of the system that emitted it
+        GLenum          type;                       ///< Error, performance warning, ...
+        GLuint          id;                         ///< Implementation-defined message identifier
+        GLenum          severity;                   ///< How important it is
+        std::string     text;                       ///< Human-readable description
+
+        bool            isError() const noexcept    ///< True for messages describing an API error
+            { return type == GL_DEBUG_TYPE_ERROR; }
+    };
+
+public:
+    /// Start collecting messages if current context supports it, do nothing otherwise
+    DebugLog();
+    DebugLog(const DebugLog &) = delete;
+    ~DebugLog();
+
+    DebugLog & operator=(const DebugLog &) = delete;
+
+    /// Check whether current context can report messages
+    static bool isSupported();
+
+    bool        active() const noexcept             ///< True if callback is installed
+        { return m_active; }
+
+    /// Get all buffered messages, emptying the buffer
+    std::vector<Message> take();
+    /// Get number of messages lost because the buffer was full, and reset it
+    unsigned    takeDropped();
+
+    static const char * sourceName(GLenum);         ///< Get a short name for a message source
+    static const char * typeName(GLenum);           ///< Get a short name for a message type
+    static const char * severityName(GLenum);       ///< Get a short name for a message severity
+
+private:
+    /// Callback invoked by the driver
+    static void GLAPIENTRY callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                    GLsizei length, const GLchar * message, const void * self);
+
+private:
+    bool                    m_active = false;       ///< Whether callback is installed
+    std::mutex              m_mutex;                ///< Protects members below
+    std::vector<Message>    m_messages;             ///< Messages received since last take()
+    unsigned                m_dropped = 0;          ///< Messages lost since last takeDropped()
+};
+
+/****************************************************************************/
+
+}
+
+#endif
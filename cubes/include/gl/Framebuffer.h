@@ -0,0 +1,71 @@
+#ifndef FRAMEBUFFER_H_0C4B98E1
+#define FRAMEBUFFER_H_0C4B98E1
+
+#include <utility>
+#include "gl/common.h"
+
+namespace gl {
+
+/****************************************************************************/
+
+/** Offscreen render target, with color and depth-stencil renderbuffers
+ *
+ * Rendering into a framebuffer object does not depend on the window being
+ * visible, or even existing, so it works on hidden windows and surfaceless
+ * contexts alike.
+ */
+class Framebuffer final
+{
+    using id_type = GLuint;                         ///< Internal type of framebuffer identifier
+    static constexpr id_type invalid_id = 0;        ///< Sentinel value for empty framebuffer
+public:
+    Framebuffer() = default;                        ///< Create an invalid framebuffer
+    /// Create a framebuffer with RGBA8 color and 24-bit depth, 8-bit stencil
+    Framebuffer(GLsizei width, GLsizei height);
+    Framebuffer(const Framebuffer &) = delete;
+    Framebuffer(Framebuffer && rhs) noexcept { swap(rhs); }
+    ~Framebuffer()
+        { clear(); }
+
+    Framebuffer & operator=(Framebuffer && rhs)
+    {
+        clear();
+        swap(rhs);
+        return *this;
+    }
+
+    id_type     id() const noexcept                 ///< Get OpenGL framebuffer identifier
+        { return m_id; }
+    GLsizei     width() const noexcept { return m_width; }
+    GLsizei     height() const noexcept { return m_height; }
+
+    void        clear();                            ///< Delete framebuffer and renderbuffers, if any
+
+    /// Direct rendering to this framebuffer, and set viewport to cover it
+    void        bind() const;
+    /// Direct rendering to the window again
+    static void unbind();
+
+    /// Swap this framebuffer with another
+    void        swap(Framebuffer & rhs) noexcept
+    {
+        std::swap(m_id, rhs.m_id);
+        std::swap(m_color, rhs.m_color);
+        std::swap(m_depth, rhs.m_depth);
+        std::swap(m_width, rhs.m_width);
+        std::swap(m_height, rhs.m_height);
+    }
+
+private:
+    id_type     m_id = invalid_id;                  ///< OpenGL framebuffer object
+    GLuint      m_color = 0;                        ///< Color renderbuffer
+    GLuint      m_depth = 0;                        ///< Depth-stencil renderbuffer
+    GLsizei     m_width = 0;                        ///< Width in pixels
+    GLsizei     m_height = 0;                       ///< Height in pixels
+};
+
+/****************************************************************************/
+
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef PIXELREADBACK_H_8D35E1A7
+#define PIXELREADBACK_H_8D35E1A7
+
+#include <cassert>
+#include <chrono>
+#include <vector>
+#include "gl/common.h"
+#include "gl/Buffer.h"
+#include "gl/Sync.h"
+
+namespace gl {
+
+/****************************************************************************/
+
+/** Ring of pixel pack buffers, reading back framebuffer contents asynchronously
+ *
+ * A plain glReadPixels() into client memory waits for the GPU to finish every
+ * command issued so far, then copies, draining the whole pipeline. Here, reads
+ * target a pixel pack buffer instead, so the call returns immediately and the
+ * copy happens on the GPU timeline. A fence is inserted after it.
+ *
+ * Buffers are only mapped once their fence is signaled, usually a few frames
+ * later, by which time the copy is complete and mapping costs no wait.
+ * Reads are retrieved in the order they were issued.
+ */
+class PixelReadback final
+{
+public:
+    static constexpr std::size_t pixelSize = 4;    ///< Bytes per pixel, read as RGBA8
+
+public:
+    PixelReadback() = default;                      ///< Create an invalid readback ring
+
+    /// Create a ring of frames buffers, for reading width x height pixels each
+    PixelReadback(GLsizei width, GLsizei height, unsigned frames = 3)
+     : m_width(width), m_height(height), m_slots(frames)
+    {
+        assert(frames > 0);
+        for (auto & slot : m_slots) {
+            slot.buffer.bind();
+            slot.buffer.setData(nullptr, frameSize(), PixelPackBuffer::usage::StreamRead);
+        }
+        PixelPackBuffer::unbind();
+    }
+
+    PixelReadback(PixelReadback &&) = default;
+    PixelReadback & operator=(PixelReadback &&) = default;
+
+    bool        valid() const noexcept              ///< True if buffers were allocated
+        { return !m_slots.empty(); }
+    GLsizei     width() const noexcept { return m_width; }
+    GLsizei     height() const noexcept { return m_height; }
+    std::size_t frameSize() const noexcept          ///< Get size of one read, in bytes
+        { return std::size_t(m_width) * std::size_t(m_height) * pixelSize; }
+
+    unsigned    pending() const noexcept            ///< Get number of reads not retrieved yet
+        { return m_pending; }
+    bool        full() const noexcept               ///< True if no buffer is available for read()
+        { return m_pending == m_slots.size(); }
+    unsigned    stalls() const noexcept             ///< Get how many times retrieve() had to wait
+        { return m_stalls; }
+
+    /// Start reading the lower-left corner of current read framebuffer into next buffer.
+    /// Rows are stored bottom to top, as OpenGL numbers them. Ring must not be full.
+    void read()
+    {
+        assert(!full());
+        auto & slot = m_slots[(m_first + m_pending) % m_slots.size()];
+        slot.buffer.bind();
+        glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        PixelPackBuffer::unbind();                  // other reads would land in our buffer
+        slot.fence = Fence::insert();
+        ++m_pending;
+    }
+
+    /// Hand pixels of oldest pending read to fn, if the GPU completed it.
+    /// Pixels are only valid during the call.
+    /// @param wait If set, wait for the GPU to complete the read instead of returning false
+    /// @return true if fn was called
+    template <typename F> bool retrieve(F && fn, bool wait)
+    {
+        if (m_pending == 0) { return false; }
+        auto & slot = m_slots[m_first];
+        if (!slot.fence.wait(std::chrono::nanoseconds::zero())) {
+            if (!wait) { return false; }
+            ++m_stalls;
+            while (!slot.fence.wait(std::chrono::seconds(1))) {}
+        }
+        slot.fence.clear();
+
+        slot.buffer.bind();
+        fn(static_cast<const unsigned char *>(slot.buffer.map(0, frameSize(), GL_MAP_READ_BIT)));
+        slot.buffer.unmap();
+        PixelPackBuffer::unbind();
+
+        m_first = (m_first + 1) % unsigned(m_slots.size());
+        --m_pending;
+        return true;
+    }
+
+private:
+    /// A single read
+    struct Slot
+    {
+        PixelPackBuffer     buffer;                 ///< Destination of the read
+        Fence               fence;                  ///< Signaled once read completed
+    };
+
+private:
+    GLsizei             m_width = 0;                ///< Width of reads, in pixels
+    GLsizei             m_height = 0;               ///< Height of reads, in pixels
+    std::vector<Slot>   m_slots;                    ///< Ring of buffers
+    unsigned            m_first = 0;                ///< Index of oldest pending read
+    unsigned            m_pending = 0;              ///< Number of pending reads
+    unsigned            m_stalls = 0;               ///< Number of waits on fences
+};
+
+/****************************************************************************/
+
+}
+
+#endif
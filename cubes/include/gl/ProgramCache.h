@@ -0,0 +1,127 @@
+#ifndef PROGRAMCACHE_H_B7E2049D
+#define PROGRAMCACHE_H_B7E2049D
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "gl/common.h"
+#include "gl/Shader.h"
+
+namespace gl {
+
+class ProgramCache;
+
+/****************************************************************************/
+
+/** Handle on a program being compiled and linked in the background
+ *
+ * With KHR_parallel_shader_compile, the driver works on other threads and
+ * ready() tells whether it is done without waiting. The main loop polls it
+ * every frame, and only calls take() once it returns true. Without the
+ * extension, ready() is always true and take() waits for the driver.
+ */
+class PendingProgram final
+{
+public:
+    PendingProgram() = default;                     ///< Create an empty handle
+    PendingProgram(PendingProgram &&) = default;
+    PendingProgram & operator=(PendingProgram &&) = default;
+
+    bool        valid() const noexcept              ///< True if a program is pending
+        { return m_program.id() != 0; }
+
+    /// Check whether program can be taken without waiting for the driver
+    bool        ready() const;
+
+    /// Get the linked program, saving it to the cache it came from, leaving the handle empty
+    /// @throw std::runtime_error with compiler logs if compilation or linkage failed
+    Program     take();
+
+private:
+    std::vector<Shader> m_shaders;                  ///< Shaders being compiled, empty if loaded from a binary
+    Program     m_program;                          ///< Program being linked
+    ProgramCache * m_cache = nullptr;               ///< Cache to save program to, if any
+    std::uint64_t m_key = 0;                        ///< Cache key of program
+    bool        m_poll = false;                     ///< Whether completion can be polled
+
+    friend class ProgramCache;
+};
+
+/****************************************************************************/
+
+/** On-disk cache of linked program binaries
+ *
+ * Compiling and linking shaders is slow, and drivers do it again every run.
+ * This cache saves linked programs with glGetProgramBinary(), and loads them
+ * back with glProgramBinary() on next run, skipping compilation entirely.
+ *
+ * Binaries only work with the driver that produced them, so each is keyed by
+ * a hash of shader sources along with OpenGL vendor, renderer and version
+ * strings. Whenever a binary is missing or rejected, shaders are compiled as
+ * usual and the cache entry rewritten.
+ *
+ * A default-constructed cache, or one used on a context lacking program
+ * binaries, simply compiles every time.
+ */
+class ProgramCache final
+{
+public:
+    /// Source code of one shader stage
+    struct Source
+    {
+        Shader::type    type;                       ///< Pipeline stage
+        const void *    data;                       ///< GLSL code
+        std::size_t     size;                       ///< Length of code, in bytes
+    };
+
+    /// Cache statistics
+    struct Counters
+    {
+        unsigned        hits = 0;                   ///< Programs loaded from a binary
+        unsigned        misses = 0;                 ///< Programs compiled from sources
+    };
+
+public:
+    ProgramCache() = default;                       ///< Create a disabled cache
+    /// Create a cache storing binaries in given directory, created as needed
+    explicit ProgramCache(std::string directory);
+
+    /// Check whether current context can save and load program binaries
+    static bool isSupported();
+
+    bool        enabled() const noexcept            ///< True if binaries are saved and loaded
+        { return !m_directory.empty(); }
+    const Counters & counters() const noexcept      ///< Get cache statistics
+        { return m_counters; }
+
+    /// Get a linked program from its sources, loading it from the cache if possible
+    /// @throw std::runtime_error with compiler logs if compilation or linkage fails
+    Program     link(const std::vector<Source> & sources);
+
+    /// Start getting a linked program from its sources, without waiting for the driver
+    /// if it supports parallel compilation. The cache must outlive the returned handle.
+    PendingProgram linkAsync(const std::vector<Source> & sources);
+
+private:
+    /// Compute cache key for sources on current driver
+    static std::uint64_t key(const std::vector<Source> & sources);
+    /// Get path of cache file for given key
+    std::string path(std::uint64_t key) const;
+
+    /// Load program from cache file, returning an invalid program on failure
+    Program     load(std::uint64_t key) const;
+    /// Save program binary to cache file, ignoring failures
+    void        save(std::uint64_t key, const Program & program) const;
+
+private:
+    std::string m_directory;                        ///< Where to store binaries, empty if disabled
+    Counters    m_counters;                         ///< Cache statistics
+
+    friend class PendingProgram;
+};
+
+/****************************************************************************/
+
+}
+
+#endif
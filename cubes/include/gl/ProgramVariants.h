@@ -0,0 +1,163 @@
+#ifndef PROGRAMVARIANTS_H_61AF3C28
+#define PROGRAMVARIANTS_H_61AF3C28
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "gl/common.h"
+#include "gl/ProgramCache.h"
+#include "gl/Shader.h"
+
+namespace gl {
+
+/****************************************************************************/
+
+/** Set of optional shader features, as a bitmask of enumeration values
+ *
+ * E is an enumeration whose values are consecutive feature indices, starting
+ * at 0. Sets are built at compile time:
+ *
+ *     constexpr auto features = Features<feature>(feature::Fog) | feature::VertexColor;
+ */
+template <typename E> class Features final
+{
+public:
+    constexpr Features() noexcept = default;                ///< Create an empty set
+    constexpr Features(E value) noexcept                    ///< Create a set of a single feature
+        : m_bits(std::uint32_t(1) << static_cast<unsigned>(value)) {}
+
+    constexpr std::uint32_t bits() const noexcept { return m_bits; }
+    constexpr bool has(E value) const noexcept              ///< True if feature is in the set
+        { return (m_bits & Features(value).m_bits) != 0; }
+
+    constexpr Features operator|(Features rhs) const noexcept { return Features(m_bits | rhs.m_bits); }
+    constexpr bool operator==(Features rhs) const noexcept { return m_bits == rhs.m_bits; }
+    constexpr bool operator!=(Features rhs) const noexcept { return m_bits != rhs.m_bits; }
+
+private:
+    explicit constexpr Features(std::uint32_t bits) noexcept : m_bits(bits) {}
+    std::uint32_t   m_bits = 0;                             ///< One bit per enabled feature
+};
+
+/****************************************************************************/
+
+/** Specialize GLSL source by defining preprocessor macros
+ *
+ * Each name gets a `#define NAME 1` line inserted right after the `#version`
+ * directive, which must come first. A `#line` directive follows, so compiler
+ * messages still refer to lines of the original source.
+ *
+ * Sources declare the features they support with a line such as
+ * `#pragma features FOG VERTEX_COLOR`, which compilers ignore. Defining a name
+ * no stage declared is an error, as it would silently do nothing.
+ */
+std::string specializeShader(const void * source, std::size_t size,
+                             const std::vector<const char *> & defines);
+
+/// Get the names of features declared by a GLSL source's `#pragma features` line
+std::vector<std::string> declaredFeatures(const void * source, std::size_t size);
+
+/****************************************************************************/
+
+/** Family of programs generated from the same sources, one per feature set
+ *
+ * Disabled features are compiled out by the preprocessor, rather than tested
+ * at run time, so every variant only pays for what it uses. Variants are
+ * compiled on first use, through a ProgramCache, so they are also saved
+ * across runs.
+ */
+template <typename E> class ProgramVariants final
+{
+public:
+    ProgramVariants() = default;                    ///< Create an empty family
+
+    /// Create a family of programs
+    /// @param cache Cache to link programs through, must outlive the family
+    /// @param sources All stages, declaring their features with `#pragma features`
+    /// @param names Macro name of every feature, indexed by enumeration value
+    ProgramVariants(ProgramCache & cache, std::vector<ProgramCache::Source> sources,
+                    std::vector<const char *> names)
+     : m_cache(&cache), m_sources(std::move(sources)), m_names(std::move(names))
+    {
+        std::vector<std::string> declared;
+        for (const auto & source : m_sources) {
+            auto features = declaredFeatures(source.data, source.size);
+            declared.insert(declared.end(), features.begin(), features.end());
+        }
+        for (std::size_t idx = 0; idx < m_names.size(); ++idx) {
+            for (const auto & name : declared) {
+                if (name == m_names[idx]) { m_declared |= std::uint32_t(1) << idx; }
+            }
+        }
+    }
+
+    ProgramVariants(ProgramVariants &&) = default;
+    ProgramVariants & operator=(ProgramVariants &&) = default;
+
+    /// Start compiling variant for given features in the background, if not done yet
+    void prepare(Features<E> features)
+    {
+        auto & entry = m_entries[features.bits()];
+        if (entry.program.id() != 0 || entry.pending.valid()) { return; }
+
+        if ((features.bits() & ~m_declared) != 0) {
+            throw gl::error("requested shader features are not declared by any stage");
+        }
+        std::vector<const char *> defines;
+        for (std::size_t idx = 0; idx < m_names.size(); ++idx) {
+            if (features.bits() & (std::uint32_t(1) << idx)) { defines.push_back(m_names[idx]); }
+        }
+
+        // Specialized code must stay alive until linkAsync() returns
+        std::vector<std::string> code;
+        std::vector<ProgramCache::Source> sources;
+        code.reserve(m_sources.size());
+        for (const auto & source : m_sources) {
+            code.push_back(specializeShader(source.data, source.size, defines));
+            sources.push_back({ source.type, code.back().data(), code.back().size() });
+        }
+        entry.pending = m_cache->linkAsync(sources);
+    }
+
+    /// Check whether variant for given features can be used without waiting,
+    /// starting its compilation if needed
+    bool ready(Features<E> features)
+    {
+        prepare(features);
+        const auto & entry = m_entries[features.bits()];
+        return entry.program.id() != 0 || entry.pending.ready();
+    }
+
+    /// Get variant for given features, waiting for it to compile if needed
+    /// @throw std::runtime_error with compiler logs if compilation or linkage fails
+    const Program & get(Features<E> features)
+    {
+        prepare(features);
+        auto & entry = m_entries[features.bits()];
+        if (entry.pending.valid()) { entry.program = entry.pending.take(); }
+        return entry.program;
+    }
+
+private:
+    /// A single variant
+    struct Entry
+    {
+        PendingProgram  pending;                    ///< Variant while it compiles
+        Program         program;                    ///< Variant once compiled
+    };
+
+private:
+    ProgramCache *                  m_cache = nullptr;  ///< Cache to link programs through
+    std::vector<ProgramCache::Source> m_sources;    ///< Unspecialized sources of all stages
+    std::vector<const char *>       m_names;        ///< Macro name of every feature
+    std::uint32_t                   m_declared = 0; ///< Features declared by at least one stage
+    std::unordered_map<std::uint32_t, Entry> m_entries; ///< Variants requested so far, by feature bits
+};
+
+/****************************************************************************/
+
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef QUERY_H_5E7D1C93
+#define QUERY_H_5E7D1C93
+
+#include <utility>
+#include "gl/common.h"
+
+namespace gl {
+
+/****************************************************************************/
+
+/** Object wrapper for OpenGL asynchronous queries
+ *
+ * A query records some value on the GPU, such as the time at which it reached
+ * a point of the command stream. Results become available some time later,
+ * usually a frame or two, and reading them before that stalls the CPU.
+ */
+class Query final
+{
+    using id_type = GLuint;                         ///< Internal type of query identifier
+    static constexpr id_type invalid_id = 0;        ///< Sentinel value for empty query
+public:
+    /// Kind of value a query measures, between begin() and end()
+    enum class target {
+        TimeElapsed = GL_TIME_ELAPSED,              ///< GPU time spent on commands, in nanoseconds
+        SamplesPassed = GL_SAMPLES_PASSED,          ///< Number of samples passing depth test
+        AnySamplesPassed = GL_ANY_SAMPLES_PASSED,   ///< Whether any sample passed depth test
+        PrimitivesGenerated = GL_PRIMITIVES_GENERATED, ///< Number of primitives emitted
+    };
+
+public:
+    Query();                                        ///< Create a new query object
+    Query(const Query &) = delete;
+    Query(Query && rhs) noexcept { std::swap(m_id, rhs.m_id); }
+    ~Query()
+        { clear(); }
+
+    Query & operator=(Query && rhs)
+    {
+        clear();
+        std::swap(m_id, rhs.m_id);
+        return *this;
+    }
+
+    id_type     id() const noexcept                 ///< Get OpenGL query identifier
+        { return m_id; }
+
+    void        clear()                             ///< Delete wrapped query, if any.
+    {
+        if (m_id != invalid_id) {
+            glDeleteQueries(1, &m_id);
+            m_id = invalid_id;
+        }
+    }
+
+    /// Start measuring. Only one query per target may be active at a time.
+    void        begin(target);
+    /// Stop measuring
+    static void end(target);
+    /// Record GPU time once all previous commands complete, in nanoseconds
+    void        timestamp();
+
+    /// Check whether result can be read without blocking
+    bool        isAvailable() const;
+    /// Read result, blocking until it is available
+    GLuint64    result() const;
+
+private:
+    id_type     m_id = invalid_id;                  ///< OpenGL query object
+};
+
+/****************************************************************************/
+
+}
+
+#endif
@@ -1,9 +1,11 @@
 #ifndef SHADER_H_9D365E73
 #define SHADER_H_9D365E73
 
+#include <cassert>
 #include <string>
 #include <vector>
 #include "gl/common.h"
+#include "gl/State.h"
 
 namespace gl {
 
@@ -52,6 +54,15 @@ public:
 
     bool        hasError() const;                   ///< True if shader compilation failed
     std::string error() const;                      ///< Compilation logs
+    /// True once compilation finished, so hasError() will not block.
+    /// Requires KHR or ARB_parallel_shader_compile, see isParallelSupported().
+    bool        isCompleted() const;
+
+    /// Check whether current context compiles shaders in the background
+    static bool isParallelSupported();
+    /// Set how many background threads compile shaders, ~0u for the driver's choice
+    /// Throws gl::error if parallel compilation is not supported.
+    static void setCompilerThreads(GLuint count);
 
     /// Compile shader from glsl code in given buffer
     static Shader compile(type, const void * data, std::size_t len);
@@ -91,21 +102,40 @@ public:
     {
         if (m_id != invalid_id) {
             glDeleteProgram(m_id);
+            StateCache::current().forgetProgram(m_id);
             m_id = invalid_id;
         }
     }
 
     bool        hasError() const;                   ///< True if program linkage failed
     std::string error() const;                      ///< Linkage logs
+    /// True once linkage finished, so hasError() will not block.
+    /// Requires KHR_parallel_shader_compile, see Shader::isParallelSupported().
+    bool        isCompleted() const;
 
     void        enable() const                      ///< Make the program active in rendering state
     {
         assert(m_id != invalid_id);
-        glUseProgram(m_id);
+        StateCache::current().useProgram(m_id);
     }
 
+    /// Run a compute program over a grid of work groups. Program must be active.
+    void        dispatch(GLuint groupsX, GLuint groupsY = 1, GLuint groupsZ = 1) const
+    {
+        assert(StateCache::current().program() == m_id);
+        glDispatchCompute(groupsX, groupsY, groupsZ);
+    }
+
+    /// Get the driver-specific binary form of linked program, for caching
+    /// @param[out] format Driver-specific format identifier, needed to load it back
+    std::vector<unsigned char> binary(GLenum & format) const;
+
     /// Link program from a set of shaders
-    static Program link(std::vector<Shader *>);
+    /// @param retrievable Hint the driver binary() will be called
+    static Program link(std::vector<Shader *>, bool retrievable = false);
+    /// Load program from a binary obtained through binary(), possibly by an earlier run.
+    /// Loading fails if driver or hardware changed since, which hasError() reports.
+    static Program load(GLenum format, const void * data, std::size_t size);
     template<typename... Ts> static Program link(Ts&... args) { return link({&args...}); }
 
 private:
@@ -0,0 +1,220 @@
+#ifndef STATE_H_C81F4A6E
+#define STATE_H_C81F4A6E
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "gl/common.h"
+
+namespace gl {
+
+/****************************************************************************/
+
+/// Server-side capabilities, toggled with glEnable() and glDisable()
+enum class capability {
+    Blend = GL_BLEND,                               ///< Blend fragments with framebuffer
+    CullFace = GL_CULL_FACE,                        ///< Discard faces by winding
+    DepthTest = GL_DEPTH_TEST,                      ///< Discard fragments by depth
+    FramebufferSRGB = GL_FRAMEBUFFER_SRGB,          ///< Convert output to sRGB
+    Multisample = GL_MULTISAMPLE,                   ///< Use multiple samples per pixel
+    PolygonOffsetFill = GL_POLYGON_OFFSET_FILL,     ///< Offset depth of filled polygons
+    PrimitiveRestart = GL_PRIMITIVE_RESTART,        ///< Restart primitives on a special index
+    RasterizerDiscard = GL_RASTERIZER_DISCARD,      ///< Stop pipeline before rasterization
+    ScissorTest = GL_SCISSOR_TEST,                  ///< Discard fragments outside scissor box
+    StencilTest = GL_STENCIL_TEST,                  ///< Discard fragments by stencil
+};
+
+/****************************************************************************/
+
+/** Shadow copy of OpenGL context state, eliding redundant state changes
+ *
+ * Every state change goes through this cache, which only forwards it to
+ * OpenGL if it actually changes something. All wrappers use the cache of
+ * the context that is current on the calling thread. State nobody set yet
+ * is unknown, so the first change is always issued.
+ *
+ * Creating a cache makes it current on the calling thread. Applications
+ * juggling several contexts must call makeCurrent() whenever they switch
+ * context, and invalidate() after third-party code touched OpenGL state.
+ */
+class StateCache final
+{
+public:
+    static constexpr GLuint unknown = ~GLuint(0);  ///< Binding not known to the cache
+
+    /// Number of state changes requested
+    struct Counters
+    {
+        unsigned long   issued = 0;                 ///< Changes forwarded to OpenGL
+        unsigned long   elided = 0;                 ///< Changes skipped as redundant
+    };
+
+public:
+    StateCache();                                   ///< Create a cache and make it current
+    StateCache(const StateCache &) = delete;
+    ~StateCache();
+
+    StateCache & operator=(const StateCache &) = delete;
+
+    /// Get the cache of the context current on this thread
+    static StateCache & current();
+    /// Make this cache current on calling thread, along with its context
+    void        makeCurrent() noexcept;
+    /// Forget all state, so next changes are always issued
+    void        invalidate();
+
+    const Counters & counters() const noexcept      ///< Get state change statistics
+        { return m_counters; }
+    void        resetCounters() noexcept            ///< Reset state change statistics
+        { m_counters = {}; }
+
+    // Capabilities
+
+    /// Enable or disable a capability
+    void        enable(capability cap, bool value = true)
+    {
+        auto & state = lookup(m_capabilities, GLenum(cap), GLuint(unknown));
+        if (elide(state == GLuint(value))) { return; }
+        state = GLuint(value);
+        if (value) { glEnable(GLenum(cap)); } else { glDisable(GLenum(cap)); }
+    }
+    /// Disable a capability
+    void        disable(capability cap) { enable(cap, false); }
+
+    // Object bindings
+
+    void        useProgram(GLuint id)               ///< Make a program active
+    {
+        if (elide(m_program == id)) { return; }
+        m_program = id;
+        glUseProgram(id);
+    }
+    GLuint      program() const noexcept            ///< Get active program
+        { return m_program; }
+
+    void        bindVertexArray(GLuint id)          ///< Bind a vertex array
+    {
+        if (elide(m_vertexArray == id)) { return; }
+        m_vertexArray = id;
+        glBindVertexArray(id);
+        // Element array binding is part of vertex array state
+        lookup(m_buffers, GL_ELEMENT_ARRAY_BUFFER, unknown) = unknown;
+    }
+    GLuint      vertexArray() const noexcept        ///< Get bound vertex array
+        { return m_vertexArray; }
+
+    void        bindBuffer(GLenum target, GLuint id) ///< Bind a buffer to a target
+    {
+        auto & state = lookup(m_buffers, target, unknown);
+        if (elide(state == id)) { return; }
+        state = id;
+        glBindBuffer(target, id);
+    }
+    GLuint      buffer(GLenum target)               ///< Get buffer bound to a target
+        { return lookup(m_buffers, target, unknown); }
+
+    /// Bind a range of a buffer to an indexed target, eg: a uniform block binding point.
+    /// Also binds the buffer to the generic target, as OpenGL does.
+    void        bindBufferRange(GLenum target, GLuint index, GLuint id,
+                                GLintptr offset, GLsizeiptr size);
+
+    // Object deletion - OpenGL unbinds deleted objects, caches must follow.
+    // Programs also forget uniforms on linking.
+
+    /// Called when deleting a program, or (re)linking or loading one, which resets
+    /// its uniforms and may move their locations
+    void        forgetProgram(GLuint id);
+    void        forgetVertexArray(GLuint id);       ///< Called when deleting a vertex array
+    void        forgetBuffer(GLuint id);            ///< Called when deleting a buffer
+
+    // Blending and depth
+
+    void        blendFunc(GLenum src, GLenum dst)   ///< Set blending factors
+    {
+        if (elide(m_blendSrc == src && m_blendDst == dst)) { return; }
+        m_blendSrc = src;
+        m_blendDst = dst;
+        glBlendFunc(src, dst);
+    }
+    void        blendEquation(GLenum mode)          ///< Set blending operation
+    {
+        if (elide(m_blendEquation == mode)) { return; }
+        m_blendEquation = mode;
+        glBlendEquation(mode);
+    }
+    void        depthFunc(GLenum func)              ///< Set depth comparison function
+    {
+        if (elide(m_depthFunc == func)) { return; }
+        m_depthFunc = func;
+        glDepthFunc(func);
+    }
+    void        depthMask(bool write)               ///< Enable or disable depth writes
+    {
+        if (elide(m_depthMask == GLuint(write))) { return; }
+        m_depthMask = GLuint(write);
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+
+    // Uniforms of active program
+
+    void        uniform1i(GLint location, GLint value);             ///< Set an int or sampler
+    void        uniform1f(GLint location, GLfloat value);           ///< Set a float
+    void        uniform4fv(GLint location, const GLfloat * value);  ///< Set a vec4
+    void        uniformMatrix4fv(GLint location, const GLfloat * value); ///< Set a mat4
+
+private:
+    /// Count a state change, returning true if it can be skipped
+    bool        elide(bool redundant) noexcept
+    {
+        if (redundant) { ++m_counters.elided; } else { ++m_counters.issued; }
+        return redundant;
+    }
+
+    /// Find value for key in a small map, adding it with given initial value if missing
+    static GLuint & lookup(std::vector<std::pair<GLenum, GLuint>> & map, GLenum key, GLuint init)
+    {
+        for (auto & entry : map) {
+            if (entry.first == key) { return entry.second; }
+        }
+        map.emplace_back(key, init);
+        return map.back().second;
+    }
+
+    /// Update cached value of a uniform, returning true if it changed
+    bool        uniformChanged(GLint location, const void * data, std::size_t size);
+
+private:
+    Counters    m_counters;                         ///< State change statistics
+
+    std::vector<std::pair<GLenum, GLuint>> m_capabilities;  ///< State of every capability
+    std::vector<std::pair<GLenum, GLuint>> m_buffers;       ///< Buffer bound to every target
+
+    /// Buffer range bound to an indexed target
+    struct IndexedBinding
+    {
+        GLenum      target;                         ///< Indexed target, eg: GL_UNIFORM_BUFFER
+        GLuint      index;                          ///< Binding point
+        GLuint      id;                             ///< Bound buffer
+        GLintptr    offset;                         ///< Start of range in bytes
+        GLsizeiptr  size;                           ///< Size of range in bytes
+    };
+    std::vector<IndexedBinding> m_indexedBuffers;   ///< Buffer range bound to every indexed target
+    GLuint      m_program = unknown;                ///< Active program
+    GLuint      m_vertexArray = unknown;            ///< Bound vertex array
+
+    GLenum      m_blendSrc = unknown;               ///< Source blending factor
+    GLenum      m_blendDst = unknown;               ///< Destination blending factor
+    GLenum      m_blendEquation = unknown;          ///< Blending operation
+    GLenum      m_depthFunc = unknown;              ///< Depth comparison function
+    GLuint      m_depthMask = unknown;              ///< Whether depth writes are enabled
+
+    /// Last value of every uniform, by program and location
+    std::unordered_map<std::uint64_t, std::vector<unsigned char>> m_uniforms;
+};
+
+/****************************************************************************/
+
+}
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef STREAMBUFFER_H_D1F8263B
+#define STREAMBUFFER_H_D1F8263B
+
+#include <cassert>
+#include <chrono>
+#include <utility>
+#include <vector>
+#include "gl/common.h"
+#include "gl/Buffer.h"
+#include "gl/Sync.h"
+
+namespace gl {
+
+/****************************************************************************/
+
+/** Ring buffer for streaming dynamic data to the GPU
+ *
+ * Allocates immutable storage that remains mapped, coherently, for the whole
+ * buffer lifetime. Storage is split into a fixed number of frame regions that
+ * are used in turn. Data written into current region is seen by the GPU as is,
+ * without any driver copy or explicit flush.
+ *
+ * A fence is inserted when a frame ends, and waited for before its region is
+ * used again, so the CPU never overwrites data the GPU is still reading. With
+ * enough frames in the ring, that wait is almost always already satisfied.
+ *
+ * Frame regions are padded to the largest alignment allocations will need, so
+ * every region starts as aligned as the buffer itself.
+ *
+ * Requires OpenGL 4.4 or ARB_buffer_storage.
+ */
+template <target Target> class StreamBuffer final
+{
+    static constexpr GLbitfield mapFlags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+public:
+    /// A chunk of memory in current frame region
+    struct Allocation
+    {
+        void *      data;       ///< Client address to write data to
+        std::size_t offset;     ///< Offset within buffer, for binding or attribute pointers
+
+        template <typename T> T * as() const noexcept { return static_cast<T *>(data); }
+    };
+
+public:
+    StreamBuffer() = default;                       ///< Create an invalid stream buffer
+
+    /// Allocate a ring of frames regions of at least frameSize bytes each
+    /// @param alignment Largest alignment allocate() will be asked for
+    explicit StreamBuffer(std::size_t frameSize, unsigned frames = 3, std::size_t alignment = 16)
+     : m_frameSize((frameSize + alignment - 1) / alignment * alignment),
+       m_alignment(alignment),
+       m_fences(frames)
+    {
+        assert(frames > 0);
+        assert(alignment > 0);
+        if (!isSupported()) {
+            throw gl::error("StreamBuffer requires ARB_buffer_storage");
+        }
+        m_buffer.bind();
+        m_buffer.setStorage(nullptr, m_frameSize * frames, mapFlags);
+        m_data = static_cast<unsigned char *>(m_buffer.map(0, m_frameSize * frames, mapFlags));
+        m_frame = frames - 1;
+        m_offset = m_frameSize;
+    }
+
+    StreamBuffer(StreamBuffer && rhs) noexcept { *this = std::move(rhs); }
+    StreamBuffer & operator=(StreamBuffer && rhs) noexcept
+    {
+        // Leave rhs invalid: its mapping belongs to the buffer now owned by this
+        m_buffer = std::move(rhs.m_buffer);
+        m_data = std::exchange(rhs.m_data, nullptr);
+        m_frameSize = std::exchange(rhs.m_frameSize, 0);
+        m_alignment = std::exchange(rhs.m_alignment, 1);
+        m_fences = std::exchange(rhs.m_fences, {});
+        m_frame = std::exchange(rhs.m_frame, 0u);
+        m_offset = std::exchange(rhs.m_offset, 0);
+        m_stalls = std::exchange(rhs.m_stalls, 0u);
+        return *this;
+    }
+
+    /// Check whether current context can create stream buffers
+    static bool isSupported()
+        { return hasVersion(4, 4) || hasExtension("GL_ARB_buffer_storage"); }
+
+    /// True if storage was allocated
+    bool                valid() const noexcept { return m_data != nullptr; }
+    /// Get underlying buffer, eg: for binding it to a vertex array
+    Buffer<Target> &    buffer() noexcept { return m_buffer; }
+    /// Get size of one frame region in bytes, including padding
+    std::size_t         frameSize() const noexcept { return m_frameSize; }
+    /// Get largest alignment allocate() supports
+    std::size_t         alignment() const noexcept { return m_alignment; }
+    /// Get offset of current frame region within the buffer
+    std::size_t         frameOffset() const noexcept { return m_frame * m_frameSize; }
+    /// Get how many times beginFrame() had to wait for the GPU
+    unsigned            stalls() const noexcept { return m_stalls; }
+
+    /// Move on to next frame region, waiting for the GPU to be done with it
+    void beginFrame()
+    {
+        m_frame = (m_frame + 1) % unsigned(m_fences.size());
+        m_offset = 0;
+
+        auto & fence = m_fences[m_frame];
+        if (!fence.valid()) { return; }
+        if (!fence.wait(std::chrono::nanoseconds::zero())) {
+            ++m_stalls;
+            while (!fence.wait(std::chrono::seconds(1))) {}
+        }
+        fence.clear();
+    }
+
+    /// Get a chunk of memory from current frame region
+    /// @param alignment Alignment of returned offset, dividing alignment()
+    Allocation allocate(std::size_t size, std::size_t alignment = 16)
+    {
+        assert(m_data != nullptr);
+        assert(alignment > 0 && m_alignment % alignment == 0);
+        auto offset = (m_offset + alignment - 1) / alignment * alignment;
+        if (offset + size > m_frameSize) { throw gl::error("StreamBuffer frame region exhausted"); }
+        m_offset = offset + size;
+
+        auto bufferOffset = frameOffset() + offset;
+        return { m_data + bufferOffset, bufferOffset };
+    }
+
+    /// Mark the end of current frame region use by the GPU
+    void endFrame()
+    {
+        m_fences[m_frame] = Fence::insert();
+    }
+
+private:
+    Buffer<Target>      m_buffer;               ///< Underlying storage
+    unsigned char *     m_data = nullptr;       ///< Persistent client mapping of whole storage
+    std::size_t         m_frameSize = 0;        ///< Size of one frame region in bytes
+    std::size_t         m_alignment = 1;        ///< Alignment of frame regions
+    std::vector<Fence>  m_fences;               ///< End-of-frame fence for each region
+    unsigned            m_frame = 0;            ///< Index of current frame region
+    std::size_t         m_offset = 0;           ///< Offset of first free byte in current region
+    unsigned            m_stalls = 0;           ///< Number of waits on fences
+};
+
+/****************************************************************************/
+
+// Convenient aliases for common targets
+typedef StreamBuffer<target::Array> VertexStreamBuffer;
+typedef StreamBuffer<target::Uniform> UniformStreamBuffer;
+
+/****************************************************************************/
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SYNC_H_4A0C7E21
+#define SYNC_H_4A0C7E21
+
+#include <chrono>
+#include <utility>
+#include "gl/common.h"
+
+namespace gl {
+
+/****************************************************************************/
+
+/** Object wrapper for OpenGL fence sync objects
+ *
+ * A fence is inserted into the command stream, and becomes signaled once
+ * the GPU has completed all commands issued before it. It enables the CPU
+ * to know when the GPU no longer uses some data, without stalling the whole
+ * pipeline the way glFinish() does.
+ */
+class Fence final
+{
+    using id_type = GLsync;                         ///< Internal type of fence identifier
+public:
+    Fence() = default;                              ///< Create an invalid fence
+    explicit Fence(id_type id) : m_id(id) {}        ///< Wrap OpenGL sync object
+    Fence(const Fence &) = delete;
+    Fence(Fence && rhs) noexcept { std::swap(m_id, rhs.m_id); }
+    ~Fence()
+        { clear(); }
+
+    Fence & operator=(Fence && rhs)
+    {
+        clear();
+        std::swap(m_id, rhs.m_id);
+        return *this;
+    }
+
+    id_type     id() const noexcept                 ///< Get OpenGL sync object
+        { return m_id; }
+    bool        valid() const noexcept              ///< True if fence was inserted
+        { return m_id != nullptr; }
+
+    void        clear()                             ///< Delete wrapped sync object, if any.
+    {
+        if (m_id != nullptr) {
+            glDeleteSync(m_id);
+            m_id = nullptr;
+        }
+    }
+
+    /// Check whether the GPU went past the fence, without blocking
+    bool        isSignaled() const;
+
+    /// Wait until the GPU goes past the fence, or timeout expires
+    /// @return true if fence was signaled, false on timeout.
+    bool        wait(std::chrono::nanoseconds timeout) const;
+
+    /// Insert a new fence after all commands issued so far
+    static Fence insert();
+
+private:
+    id_type     m_id = nullptr;                     ///< OpenGL sync object
+};
+
+/****************************************************************************/
+
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef UNIFORMBLOCK_H_3F9A62D0
+#define UNIFORMBLOCK_H_3F9A62D0
+
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "gl/common.h"
+#include "gl/Buffer.h"
+#include "gl/Shader.h"
+
+namespace gl {
+
+/****************************************************************************/
+
+/** Types matching the std140 layout of uniform blocks
+ *
+ * A C++ struct made of these types, and of 4-byte scalars, has the exact
+ * memory layout of a GLSL block declared with layout(std140), alignment and
+ * padding being generated by the compiler. For instance:
+ *
+ *     layout(std140) uniform Camera { mat4 viewProjection; vec3 eye; };
+ *     struct Camera { std140::mat4 viewProjection; std140::vec3 eye; };
+ *
+ * One difference: std140 packs a scalar right after a vec3, while here the vec3
+ * takes 16 bytes. Put scalars before vec3 members, or pad explicitly.
+ *
+ * Vectors and matrices are assigned from any type indexed by int, such as glm
+ * types. Matrices are column-major.
+ */
+namespace std140 {
+
+/// Vector of N components of type T, aligned on 2 or 4 components
+template <typename T, std::size_t N> struct alignas((N == 3 ? 4 : N) * sizeof(T)) vector
+{
+    static_assert(N >= 2 && N <= 4, "std140 vectors have 2 to 4 components");
+    static_assert(sizeof(T) == 4, "std140 components are 4 bytes");
+    T data[N];
+
+    vector() = default;
+    template <typename V> vector(const V & value) { *this = value; }
+    template <typename V> vector & operator=(const V & value)
+    {
+        for (int idx = 0; idx < int(N); ++idx) { data[idx] = value[idx]; }
+        return *this;
+    }
+
+    T & operator[](std::size_t idx) { return data[idx]; }
+    const T & operator[](std::size_t idx) const { return data[idx]; }
+};
+
+/// Matrix of C columns of R floats, each column aligned and padded as a vec4
+template <std::size_t C, std::size_t R> struct alignas(16) matrix
+{
+    static_assert(C >= 2 && C <= 4 && R >= 2 && R <= 4, "std140 matrices are 2x2 to 4x4");
+    float columns[C][4];
+
+    matrix() = default;
+    template <typename M> matrix(const M & value) { *this = value; }
+    template <typename M> matrix & operator=(const M & value)
+    {
+        for (int col = 0; col < int(C); ++col) {
+            for (int row = 0; row < int(R); ++row) { columns[col][row] = value[col][row]; }
+        }
+        return *this;
+    }
+};
+
+/// Array of N elements, each element aligned and padded as a vec4
+template <typename T, std::size_t N> struct array
+{
+    struct alignas(16) element { T value; };
+    element elements[N];
+
+    T & operator[](std::size_t idx) { return elements[idx].value; }
+    const T & operator[](std::size_t idx) const { return elements[idx].value; }
+};
+
+using vec2 = vector<GLfloat, 2>;
+using vec3 = vector<GLfloat, 3>;
+using vec4 = vector<GLfloat, 4>;
+using ivec2 = vector<GLint, 2>;
+using ivec3 = vector<GLint, 3>;
+using ivec4 = vector<GLint, 4>;
+using uvec2 = vector<GLuint, 2>;
+using uvec3 = vector<GLuint, 3>;
+using uvec4 = vector<GLuint, 4>;
+using mat2 = matrix<2, 2>;
+using mat3 = matrix<3, 3>;
+using mat4 = matrix<4, 4>;
+using boolean = GLuint;                             ///< GLSL bool is 4 bytes
+
+}
+
+/****************************************************************************/
+
+/** Uniform block holding many values of type T in a single buffer
+ *
+ * Values are pushed into a client-side staging area, then sent all at once
+ * with upload(). Each draw selects its own value by binding its range of the
+ * buffer to the block's binding point with glBindBufferRange, so per-draw
+ * constants cost one upload per frame instead of one glUniform per draw.
+ *
+ * T must have the std140 layout of the block, see the std140 namespace.
+ * Layout is checked against the program when attaching.
+ */
+template <typename T> class UniformBlock final
+{
+    static_assert(std::is_standard_layout<T>::value, "uniform block type must have standard layout");
+    static_assert(std::is_trivially_copyable<T>::value, "uniform block type must be trivially copyable");
+    static_assert(alignof(T) <= 16, "uniform block type cannot be aligned more than a vec4");
+public:
+    UniformBlock() = default;                       ///< Create an invalid block
+
+    /// Create a block bound to given binding point, with room for capacity values
+    explicit UniformBlock(GLuint binding, std::size_t capacity = 1)
+     : m_binding(binding)
+    {
+        GLint alignment = 1;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        m_stride = (sizeof(T) + std::size_t(alignment) - 1) / std::size_t(alignment)
+                 * std::size_t(alignment);
+        m_staging.reserve(capacity * m_stride);
+    }
+
+    UniformBlock(UniformBlock &&) = default;
+    UniformBlock & operator=(UniformBlock &&) = default;
+
+    GLuint          binding() const noexcept        ///< Get binding point shaders read from
+        { return m_binding; }
+    std::size_t     size() const noexcept           ///< Get number of values pushed this frame
+        { return m_stride == 0 ? 0 : m_staging.size() / m_stride; }
+
+    /// Connect a program's block to our binding point, checking T is large enough for it.
+    /// The driver reports the minimum size it needs, which may leave out trailing padding.
+    void attach(const Program & program, const char * name) const
+    {
+        auto index = glGetUniformBlockIndex(program.id(), name);
+        if (index == GL_INVALID_INDEX) {
+            throw gl::error(std::string("no uniform block named ") + name);
+        }
+        GLint size = 0;
+        glGetActiveUniformBlockiv(program.id(), index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+        if (std::size_t(size) > sizeof(T)) {
+            throw gl::error(std::string("uniform block ") + name + " has size "
+                            + std::to_string(size) + ", expected at most " + std::to_string(sizeof(T)));
+        }
+        glUniformBlockBinding(program.id(), index, m_binding);
+    }
+
+    /// Forget all values, starting a new frame
+    void            clear() noexcept { m_staging.clear(); }
+
+    /// Queue a value for next upload, returning its slot
+    std::size_t     push(const T & value)
+    {
+        assert(m_stride > 0);
+        auto offset = m_staging.size();
+        m_staging.resize(offset + m_stride);
+        std::memcpy(&m_staging[offset], &value, sizeof(T));
+        return offset / m_stride;
+    }
+
+    /// Send all queued values to the GPU, replacing previous storage
+    void            upload()
+    {
+        m_buffer.bind();
+        m_buffer.setData(m_staging, UniformBuffer::usage::StreamDraw);
+    }
+
+    /// Make shaders read value in given slot
+    void            bind(std::size_t slot) const
+    {
+        assert(slot < size());
+        m_buffer.bindRange(m_binding, slot * m_stride, sizeof(T));
+    }
+
+private:
+    UniformBuffer   m_buffer;                       ///< GPU storage for all values
+    GLuint          m_binding = 0;                  ///< Binding point shaders read from
+    std::size_t     m_stride = 0;                   ///< Distance between values, respecting offset alignment
+    std::vector<unsigned char> m_staging;           ///< Values pushed since last clear()
+};
+
+/****************************************************************************/
+
+}
+
+#endif
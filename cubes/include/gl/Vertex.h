@@ -1,15 +1,60 @@
 #ifndef VERTEX_H_19E3BDC5
 #define VERTEX_H_19E3BDC5
 
+#include <algorithm>
+#include <cmath>
 #include <utility>
 #include <vector>
 #include "gl/common.h"
 #include "gl/Buffer.h"
+#include "gl/State.h"
 
 namespace gl {
 
 /****************************************************************************/
 
+/** Parameters of one non-indexed draw, as read by indirect draw calls
+ *
+ * Layout is fixed by OpenGL. It matches a GLSL struct of four uints, so
+ * commands can be written either from the CPU or by a compute shader.
+ */
+struct DrawArraysIndirectCommand
+{
+    GLuint  count;                              ///< Number of vertices
+    GLuint  instanceCount;                      ///< Number of instances, 0 skips the draw
+    GLuint  first;                              ///< First vertex
+    GLuint  baseInstance;                       ///< Added to instance number for instanced attributes
+};
+
+/// Parameters of one indexed draw, as read by indirect draw calls
+struct DrawElementsIndirectCommand
+{
+    GLuint  count;                              ///< Number of indices
+    GLuint  instanceCount;                      ///< Number of instances, 0 skips the draw
+    GLuint  firstIndex;                         ///< First index, counted in indices not bytes
+    GLint   baseVertex;                         ///< Added to every index
+    GLuint  baseInstance;                       ///< Added to instance number for instanced attributes
+};
+
+/****************************************************************************/
+
+/** Pack a vector into a 32-bit value, as read by type::Int2101010 attributes
+ *
+ * Components are clamped to [-1, 1] and stored as signed normalized integers:
+ * 10 bits for x, y and z, 2 bits for w. That is plenty for unit normals and
+ * tangents, at a third of the size of 3 floats.
+ */
+inline GLuint packSnorm2101010(float x, float y, float z, float w = 0.0f)
+{
+    const auto pack = [](float value, float scale, GLuint mask) {
+        return GLuint(GLint(std::lround(std::clamp(value, -1.0f, 1.0f) * scale))) & mask;
+    };
+    return pack(x, 511.0f, 0x3ff) | pack(y, 511.0f, 0x3ff) << 10
+         | pack(z, 511.0f, 0x3ff) << 20 | pack(w, 1.0f, 0x3) << 30;
+}
+
+/****************************************************************************/
+
 /** GPU-based array of drawing data
  *
  * Ties together all non-uniform data sources into a single object that is fed to
@@ -41,13 +86,14 @@ public:
     {
         if (m_id != invalid_id) {
             glDeleteVertexArrays(1, &m_id);
+            StateCache::current().forgetVertexArray(m_id);
             m_id = invalid_id;
         }
     }
 
     void enableVertexAttrib(GLuint idx, bool val)
     {
-        assert(s_bound == m_id);
+        assert(isBound());
 #ifndef NDEBUG
         assert(m_attribArrays.at(idx) != VertexBuffer::invalid_id);
 #endif
@@ -63,7 +109,7 @@ public:
                          unsigned n, gl::type type, bool normalize,
                          GLsizei stride, GLsizei offset)
     {
-        assert(s_bound == m_id);
+        assert(isBound());
 #ifndef NDEBUG
         if (m_attribArrays.size() <= idx) {
             m_attribArrays.resize(idx + 1, VertexBuffer::invalid_id);
@@ -79,7 +125,7 @@ public:
     void setVertexAttribI(GLuint idx, VertexBuffer & buf, unsigned n, gl::type type,
                           GLsizei stride, GLsizei offset)
     {
-        assert(s_bound == m_id);
+        assert(isBound());
 #ifndef NDEBUG
         if (m_attribArrays.size() <= idx) {
             m_attribArrays.resize(idx + 1, VertexBuffer::invalid_id);
@@ -95,7 +141,7 @@ public:
     void setVertexAttribL(GLuint idx, VertexBuffer & buf, unsigned n, gl::type type,
                           GLsizei stride, GLsizei offset)
     {
-        assert(s_bound == m_id);
+        assert(isBound());
 #ifndef NDEBUG
         if (m_attribArrays.size() <= idx) {
             m_attribArrays.resize(idx + 1, VertexBuffer::invalid_id);
@@ -107,19 +153,26 @@ public:
                                stride, reinterpret_cast<void*>(offset));
     }
 
+    /// Set how many instances are drawn before an attribute advances, 0 for every vertex
+    void setVertexAttribDivisor(GLuint idx, GLuint divisor)
+    {
+        assert(isBound());
+        glVertexAttribDivisor(idx, divisor);
+    }
+
     // Drawing - single
 
     /// Draw simple primitives from the vertex array, using flat vertex bounds
     void draw(primitive prim, bounds bnd) const
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         glDrawArrays(static_cast<GLenum>(prim), bnd.first, bnd.second);
     }
 
     /// Draw indexed primitives from the vertex array, using flat index bounds
     void drawIndices(primitive prim, gl::type type, bounds bnd) const
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         glDrawElements(static_cast<GLenum>(prim), bnd.second, static_cast<GLenum>(type),
                        reinterpret_cast<void*>(bnd.first));
     }
@@ -127,7 +180,7 @@ public:
     /// Draw indexed primitives from the vertex array using index bounds with offset
     void drawIndices(primitive prim, gl::type type, bounds bnd, GLint base) const
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         glDrawElementsBaseVertex(static_cast<GLenum>(prim), bnd.second, static_cast<GLenum>(type),
                                  reinterpret_cast<void*>(bnd.first), base);
     }
@@ -138,7 +191,7 @@ public:
     void draw(primitive prim, const std::vector<GLint> & positions,
                               const std::vector<GLsizei> & counts) const
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         assert(positions.size() == counts.size());
         glMultiDrawArrays(static_cast<GLenum>(prim), positions.data(), counts.data(),
                           GLsizei(counts.size()));
@@ -149,7 +202,7 @@ public:
                      const std::vector<std::uintptr_t> & positions,
                      const std::vector<GLsizei> & counts) const
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         assert(positions.size() == counts.size());
         glMultiDrawElements(static_cast<GLenum>(prim), counts.data(), static_cast<GLenum>(type),
                             reinterpret_cast<void * const *>(positions.data()), GLsizei(counts.size()));
@@ -161,7 +214,7 @@ public:
                      const std::vector<GLsizei> & counts,
                      const std::vector<GLint> & bases) const
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         assert(positions.size() == counts.size());
         assert(positions.size() == bases.size());
         glMultiDrawElementsBaseVertex(static_cast<GLenum>(prim), counts.data(),
@@ -175,7 +228,7 @@ public:
     /// Draw multiple instances of primitives from the vertex array, using flat vertex bounds
     void drawInstanced(primitive prim, bounds bnd, GLsizei instances) const
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         glDrawArraysInstanced(static_cast<GLenum>(prim), bnd.first, bnd.second, instances);
     }
 
@@ -183,7 +236,7 @@ public:
     void drawIndicesInstanced(primitive prim, gl::type type,
                               bounds bnd, GLsizei instances) const
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         glDrawElementsInstanced(static_cast<GLenum>(prim), bnd.second, static_cast<GLenum>(type),
                                 reinterpret_cast<void*>(bnd.first), instances);
     }
@@ -192,36 +245,59 @@ public:
     void drawIndicesInstanced(primitive prim, gl::type type,
                               bounds bnd, GLint base, GLsizei instances) const
     {
-        assert(s_bound == m_id);
+        assert(isBound());
         glDrawElementsInstancedBaseVertex(static_cast<GLenum>(prim), bnd.second,
                                           static_cast<GLenum>(type),
                                           reinterpret_cast<void*>(bnd.first),
                                           base, instances);
     }
 
-    /// Bind vertex array, enabling the use of other methods
-    void bind() const
+    // Drawing - indirect
+
+    /// Check whether current context supports multi-draw indirect
+    static bool isIndirectSupported();
+
+    /// Draw from commands stored in a buffer, starting at offset, in a single call.
+    /// Stride 0 means commands are tightly packed.
+    void drawIndirect(primitive prim, const DrawIndirectBuffer & commands,
+                      std::size_t offset, GLsizei count, GLsizei stride = 0) const
     {
-        if (m_id == s_bound) { return; }
-        glBindVertexArray(m_id);
-        s_bound = m_id;
+        assert(isBound());
+        assert(commands.isBound());
+        assert(offset + std::size_t(count) * sizeof(DrawArraysIndirectCommand) <= commands.size());
+        glMultiDrawArraysIndirect(static_cast<GLenum>(prim),
+                                  reinterpret_cast<void*>(offset), count, stride);
     }
 
-    /// Unbind vertex array, leaving no active bound array
-    static void unbind()
+    /// Draw indexed primitives from commands stored in a buffer, starting at offset,
+    /// in a single call. Stride 0 means commands are tightly packed.
+    void drawIndicesIndirect(primitive prim, gl::type type, const DrawIndirectBuffer & commands,
+                             std::size_t offset, GLsizei count, GLsizei stride = 0) const
     {
-        if (s_bound == invalid_id) { return; }
-        glBindVertexArray(invalid_id);
-        s_bound = invalid_id;
+        assert(isBound());
+        assert(commands.isBound());
+        assert(offset + std::size_t(count) * sizeof(DrawElementsIndirectCommand) <= commands.size());
+        glMultiDrawElementsIndirect(static_cast<GLenum>(prim), static_cast<GLenum>(type),
+                                    reinterpret_cast<void*>(offset), count, stride);
     }
 
+    /// Bind vertex array, enabling the use of other methods
+    void bind() const
+        { StateCache::current().bindVertexArray(m_id); }
+
+    /// Unbind vertex array, leaving no active bound array
+    static void unbind()
+        { StateCache::current().bindVertexArray(invalid_id); }
+
+    /// Check whether this vertex array is currently bound
+    bool isBound() const
+        { return StateCache::current().vertexArray() == m_id; }
+
 private:
     id_type                 m_id = invalid_id;  ///< OpenGL vertex array identifier
 #ifndef NDEBUG
     std::vector<id_type>    m_attribArrays;
 #endif
-
-    static id_type          s_bound;            ///< Identifier of buffer that is currently bound
 };
 
 /****************************************************************************/
@@ -18,6 +18,13 @@ protected:
 };
 
 
+/// Check whether current context provides at least given OpenGL version
+bool hasVersion(int major, int minor);
+
+/// Check whether current context supports an extension, eg: "GL_ARB_buffer_storage"
+bool hasExtension(const char * name);
+
+
 enum class primitive {
     Points = GL_POINTS,
     LineStrip = GL_LINE_STRIP,
@@ -8,6 +8,7 @@ extern "C" {
     extern const char name[]; extern const unsigned int name ## _len;
 
 
+RESOURCE(shaders_cull_glsl)
 RESOURCE(shaders_fragment_glsl)
 RESOURCE(shaders_vertex_glsl)
 
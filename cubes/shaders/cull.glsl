@@ -0,0 +1,44 @@
+#version 430
+
+/* Compute shader runs outside the rendering pipeline. It processes one work item.
+ *
+ * This one culls instances against the view frustum: each invocation tests the
+ * bounding sphere of one instance, and copies its transform to the visible list
+ * if it may show on screen. The draw command is updated along the way, so the
+ * following indirect draw renders exactly the visible instances.
+ */
+
+layout(local_size_x = 64) in;
+
+layout(std140) uniform Frustum {
+    vec4 planes[6];                         // Frustum planes in world space, normals pointing inside
+    float radius;                           // Radius of instance bounding sphere, in model space
+    uint count;                             // Number of instances to test
+};
+
+layout(std430, binding = 0) readonly buffer Instances {
+    mat4 instances[];                       // Model matrix of every instance
+};
+layout(std430, binding = 1) writeonly buffer Visible {
+    mat4 visible[];                         // Model matrix of every visible instance
+};
+layout(std430, binding = 2) buffer Command {
+    uint indexCount;                        // Matches DrawElementsIndirectCommand
+    uint instanceCount;                     // Number of visible instances, reset by the CPU
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+void main()
+{
+    uint idx = gl_GlobalInvocationID.x;
+    if (idx >= count) { return; }
+
+    mat4 model = instances[idx];
+    vec3 center = model[3].xyz;
+    for (int plane = 0; plane < 6; ++plane) {
+        if (dot(planes[plane].xyz, center) + planes[plane].w < -radius) { return; }
+    }
+    visible[atomicAdd(instanceCount, 1u)] = model;
+}
@@ -1,15 +1,26 @@
 #version 330
+#pragma features FOG
 
 /* Fragment shader runs after rasterization. It processes one fragment.
  * Its main purpose is defining the color(s) and material.
  *
- * This is a minimal fragment shader.
+ * This is a minimal fragment shader. With FOG defined, colors fade to
+ * the background with distance.
  */
 
 in vec3 fragmentColor;              // Color passed by vertex shader
+#ifdef FOG
+in float fragmentDepth;             // Distance to the camera, passed by vertex shader
+const vec3 fogColor = vec3(0.0);    // Matches the clear color
+const float fogDensity = 0.02;      // Fraction of light lost per unit of distance
+#endif
 out vec3 color;                     // Where to write color data into
 
 void main()
 {
+#ifdef FOG
+    color = mix(fogColor, fragmentColor, exp(-fogDensity * fragmentDepth));
+#else
     color = fragmentColor;          // Simply copy the color
+#endif
 }
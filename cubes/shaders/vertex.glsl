@@ -1,21 +1,56 @@
 #version 330
+#pragma features VERTEX_COLOR FOG LIGHTING
 
 /** Vertex shader runs first. It processes one vertex.
  * Its main purpose is tranforming coordinates and sending relevant
  * data to the next shaders in the pipeline.
  *
- * This is a minimal vertex shader.
+ * This is a minimal instanced vertex shader: the model matrix comes from
+ * a per-instance attribute, so many cubes are drawn in a single call.
+ *
+ * Optional features are enabled by defining their macro, see gl::ProgramVariants:
+ *  - VERTEX_COLOR: use per-vertex colors, rather than a flat grey.
+ *  - FOG: send view depth to the fragment shader, which fades distant cubes.
+ *  - LIGHTING: shade faces by their angle to a fixed directional light.
  */
 
-layout(location = 0) in vec3 vertexPos;     // Coordinates
+layout(location = 0) in vec4 vertexPos;     // Quantized coordinates, w is 0, see MeshVertex
+#ifdef VERTEX_COLOR
 layout(location = 1) in vec3 vertexColor;   // RGB color - this shader doesn't support alpha
+#endif
+layout(location = 2) in mat4 instanceModel; // Model matrix of the instance - uses locations 2 to 5
+#ifdef LIGHTING
+layout(location = 6) in vec3 vertexNormal;  // Unit normal, unpacked from 2:10:10:10 by vertex fetch
+
+const vec3 lightDirection = vec3(0.267, 0.535, 0.802);  // Towards the light, normalized (1, 2, 3)
+const float ambient = 0.3;                  // Fraction of light reaching faces turned away
+#endif
 
-uniform mat4 mvp;                           // Transformation matrix
+layout(std140) uniform Camera {             // Constants shared by all cubes, from a uniform buffer
+    mat4 viewProjection;                    // Transformation matrix from world to screen
+    vec4 positionScale;                     // Turns quantized coordinates into model ones, w is 0
+    vec4 positionBias;                      // Added after scaling, w is 1
+};
 
 out vec3 fragmentColor;                     // This gets sent to the fragment shader
+#ifdef FOG
+out float fragmentDepth;                    // Distance to the camera, along view axis
+#endif
 
 void main()
 {
-    gl_Position = mvp * vec4(vertexPos, 1); // Apply transformation matrix
+    vec4 modelPos = vertexPos * positionScale + positionBias;           // Undo quantization
+    gl_Position = viewProjection * instanceModel * modelPos;            // Apply transformations
+#ifdef VERTEX_COLOR
     fragmentColor = vertexColor;            // Forward vertex color data
+#else
+    fragmentColor = vec3(0.6);
+#endif
+#ifdef LIGHTING
+    vec3 normal = mat3(instanceModel) * vertexNormal;   // Models only rotate, no need for inverse transpose
+    fragmentColor *= ambient + (1.0 - ambient) * max(dot(normal, lightDirection), 0.0);
+#endif
+#ifdef FOG
+    fragmentDepth = gl_Position.w;          // Perspective projection copies view depth into w
+#endif
 }
@@ -5,27 +5,59 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <iostream>
-#include <type_traits>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
 #include "gl/Shader.h"
 #include "Application.h"
+#include "MeshFile.h"
 #include "resources.h"
 
 /****************************************************************************/
 
-/// Vertex format used for our cube
-struct vertex {
-    GLbyte   x, y, z;           ///< Integer coordinates, to be normalized to [-1, 1]
-    glm::tvec3<GLubyte>  color; ///< R8G8B8
-};
-
-// Ensure the vertex has standard layout, enabling us to access members through offsets
-static_assert(std::is_standard_layout<vertex>::value, "vertex must have standard layout");
-// Ensure vertex data can be copied as raw bytes
-static_assert(std::is_trivially_copyable<vertex>::value, "vertex must be trivially copyable");
+/// Distance between centers of neighbouring cubes
+static constexpr float cubeSpacing = 4.0f;
+/// Vertical field of view, in radians
+static constexpr float fieldOfView = 45.0f * 3.14159265359f / 180.0f;
+/// Size of the window, or of the offscreen target, in pixels
+static constexpr int windowWidth = 800, windowHeight = 600;
+/// Width to height ratio of the window
+static constexpr float aspectRatio = float(windowWidth) / float(windowHeight);
+/// Simulated time between benchmark frames, in milliseconds, so every run animates the same way
+static constexpr unsigned benchFrameTime = 16;
+/// Most time simulated at once, in milliseconds. Beyond that, eg: after a breakpoint,
+/// lost time is skipped rather than having simulation race to catch up.
+static constexpr unsigned maxCatchUp = 250;
+/// Time after which all cubes are back to their initial orientation, in seconds
+static constexpr double scenePeriod = 50.0;
+/// Longest sleep waiting for events while hidden, in milliseconds, bounding time to notice m_quit
+static constexpr unsigned hiddenTimeout = 250;
+
+#ifdef NDEBUG
+static constexpr bool pollErrors = false;   ///< Release builds never wait on glGetError() in main loop
+#else
+static constexpr bool pollErrors = true;    ///< Debug builds poll glGetError() if debug output is missing
+#endif
+
+/// Get the grid dimensions to lay out a number of cubes, as columns and rows
+static std::pair<unsigned, unsigned> gridSize(unsigned count)
+{
+    auto columns = std::max(1u, unsigned(std::ceil(std::sqrt(float(count)))));
+    return { columns, (count + columns - 1) / columns };
+}
 
-static gl::VertexBuffer loadCubeData();
+/// Get how far into a tick now is, as a fraction in [0, 1]
+static float tickFraction(std::uint64_t now, std::uint64_t tickStart, std::uint64_t tickLength)
+{
+    if (now <= tickStart) { return 0.0f; }
+    return std::min(1.0f, float(now - tickStart) / float(tickLength));
+}
 
 /****************************************************************************/
 
@@ -33,131 +65,540 @@ void SDLDeleter<SDL_Window>::operator()(SDL_Window * ptr) const { SDL_DestroyWin
 
 /****************************************************************************/
 
-Application::Application(std::string name)
- : m_quit(false),
-   m_window(createWindow(name))
-{}
+Application::Application(std::string name, Options options)
+ : m_options(options),
+   m_quit(false),
+   m_window(createWindow(name, options.debug, options.benchFrames > 0)),
+   m_context(SDL_GL_GetCurrentContext()),
+   m_profiler(options.benchFrames > 0 ? 0 : options.profilePeriod, options.profileFile),
+   m_workers(options.threads)
+{
+    m_updateScope = m_profiler.addScope("update", Profiler::kind::Background);
+    m_renderScope = m_profiler.addScope("render", Profiler::kind::Work);
+    m_gpuScope = m_profiler.addScope("gpu render", Profiler::kind::Gpu);
+    m_swapScope = m_profiler.addScope("swap", Profiler::kind::Wait);
+    m_errorsScope = m_profiler.addScope("errors", Profiler::kind::Work);
+    m_tickLength = std::max<std::uint64_t>(1, SDL_GetPerformanceFrequency() / options.tickRate);
+}
 
 Application::~Application()
 {}
 
 int Application::run()
 {
-    init();
+    // Missing or corrupt files, and unsupported drivers, end here rather than in terminate()
+    try {
+        init();
+    } catch (const std::exception & error) {
+        std::cerr <<"Initialization failed: " <<error.what() <<std::endl;
+        return 1;
+    }
+    // Shaders are compiled in the background, so their errors only come up when rendering
+    if (m_options.benchFrames > 0) {
+        try {
+            return benchmark();
+        } catch (const std::exception & error) {
+            std::cerr <<"Rendering failed: " <<error.what() <<std::endl;
+            quit();
+            return 1;
+        }
+    }
 
-    auto lastTicks = milliseconds{SDL_GetTicks()};
+    // Hand the context over to the render thread. This one runs events and simulation,
+    // so neither waits on V-sync, and a burst of events never delays a frame.
+    SDL_GL_MakeCurrent(m_window.get(), nullptr);
+    unsigned long frames = 0;
+    int status = 0;
+    std::thread renderer([this, &frames, &status]() { status = renderLoop(frames); });
+
+    // Simulation runs in fixed ticks, however fast frames come, so it behaves the same
+    // at any frame rate. Elapsed time accumulates until it makes up a whole tick.
+    const auto frequency = SDL_GetPerformanceFrequency();
+    const auto start = SDL_GetPerformanceCounter();
+    auto last = start;
+    // Wake up render thread sleeping on a hidden window, once it can see why
+    const auto wakeRenderer = [this]() {
+        std::lock_guard<std::mutex> lock(m_idleMutex);
+        m_idleWake.notify_one();
+    };
     do {
-        // Handle any waiting event
-        SDL_Event event;
-        while(SDL_PollEvent(&event))
-        {
-            switch (event.type) {
-            case SDL_KEYDOWN:       onKeyDown(event.key); break;
-            case SDL_KEYUP:         onKeyUp(event.key); break;
-            case SDL_QUIT:          onQuitEvent(); break;
-            case SDL_WINDOWEVENT:   onWindowEvent(event.window); break;
+        // Handle events until next tick is due, or window shows or hides. While hidden,
+        // nothing is due: simulation pauses and this thread sleeps until an event comes,
+        // waking up now and then to check m_quit, set by signal handlers.
+        const bool visible = m_visible;
+        auto now = SDL_GetPerformanceCounter();
+        while (m_visible == visible && !m_quit.load(std::memory_order_relaxed)
+               && (!visible || m_accumulator + (now - last) < m_tickLength)) {
+            SDL_Event event;
+            auto timeout = std::uint64_t(hiddenTimeout);
+            if (visible) {
+                const auto remaining = m_tickLength - m_accumulator - (now - last);
+                timeout = (remaining * 1000 + frequency - 1) / frequency;   // round up, never wake early
+            }
+            if (SDL_WaitEventTimeout(&event, int(timeout))) {
+                switch (event.type) {
+                case SDL_KEYDOWN:       onKeyDown(event.key); break;
+                case SDL_KEYUP:         onKeyUp(event.key); break;
+                case SDL_QUIT:          onQuitEvent(); break;
+                case SDL_WINDOWEVENT:   onWindowEvent(event.window); break;
+                }
+                if (event.type == SDL_KEYDOWN || event.type == SDL_MOUSEBUTTONDOWN) {
+                    m_lastInput = SDL_GetPerformanceCounter();  // frames showing it measure latency
+                }
             }
+            now = SDL_GetPerformanceCounter();
         }
 
-        // Keep track of elapsed time and feed it to update()
-        auto ticks = milliseconds{SDL_GetTicks()};
-        update(ticks - lastTicks);
-
-        // Render to hidden buffer, then swap buffers to show the result
-        if (m_visible) { render(); }
-        SDL_GL_SwapWindow(m_window.get());
-
-        // Finalize pass
-        processErrors("mainloop errors");
-        lastTicks = ticks;
+        // Simulate elapsed ticks, then hand over the last two states. The render thread
+        // takes whichever is latest when it starts a frame, and interpolates between them.
+        if (visible) {
+            auto timer = m_profiler.time(m_updateScope);
+            advance(now - last);
+        }
+        m_frames.back() = snapshot(now);
+        m_frames.publish();
+        if (m_visible != visible) { wakeRenderer(); }
+        last = now;
     } while(!m_quit.load(std::memory_order_relaxed));
-
+    wakeRenderer();
+
+    // Take the context back, as resources are released from this thread
+    renderer.join();
+    SDL_GL_MakeCurrent(m_window.get(), m_context);
+    m_state.makeCurrent();
+    if (status != 0) { return status; }
+
+    const auto seconds = float(double(last - start) / double(frequency));
+    std::cerr <<"Rendered " <<frames <<" frames of " <<m_options.instances <<" cubes in "
+              <<seconds <<"s (" <<float(frames) / seconds <<" frames/s)\n";
+    const auto latency = m_pacer.latency();
+    if (latency.count > 0) {
+        std::cerr <<"Input to present latency: " <<latency.count <<" inputs, mean "
+                  <<latency.mean <<"ms, 95th percentile " <<latency.p95 <<"ms\n";
+    }
+    std::cerr <<"State changes: " <<m_state.counters().issued <<" issued, "
+              <<m_state.counters().elided <<" elided\n";
     std::cerr <<"Exiting" <<std::endl;
     return 0;
 }
 
-void Application::init()
+int Application::renderLoop(unsigned long & frames)
+{
+    // State cache shadows the context, so it must follow it to this thread
+    SDL_GL_MakeCurrent(m_window.get(), m_context);
+    m_state.makeCurrent();
+
+    // Nothing catches exceptions on this thread, stop everything if one comes up,
+    // eg: when a shader fails to compile
+    int status = 0;
+    try {
+        renderFrames(frames);
+        stopRecording();
+    } catch (const std::exception & error) {
+        std::cerr <<"Rendering failed: " <<error.what() <<std::endl;
+        quit();
+        status = 1;
+    }
+    SDL_GL_MakeCurrent(m_window.get(), nullptr);
+    return status;
+}
+
+void Application::renderFrames(unsigned long & frames)
 {
-    // Load shaders
-    auto vertexShader = gl::Shader::compile(gl::Shader::type::Vertex,
-                                            shaders_vertex_glsl, shaders_vertex_glsl_len);
-    if (vertexShader.hasError()) { throw std::runtime_error(vertexShader.error()); }
+    while (!m_quit.load(std::memory_order_relaxed)) {
+        // Wait until frame is due, if frame rate is capped, then take latest state
+        m_pacer.waitFrame();
+        m_frames.acquire();
+        const auto & frame = m_frames.front();
+
+        // Nothing to show, sleep until main thread publishes a visible state, or quits
+        if (!frame.visible) {
+            std::unique_lock<std::mutex> lock(m_idleMutex);
+            m_idleWake.wait(lock, [this]() {
+                return m_quit.load(std::memory_order_relaxed)
+                    || (m_frames.acquire() && m_frames.front().visible);
+            });
+            continue;
+        }
 
-    auto fragmentShader = gl::Shader::compile(gl::Shader::type::Fragment,
-                                              shaders_fragment_glsl, shaders_fragment_glsl_len);
-    if (fragmentShader.hasError()) { throw std::runtime_error(fragmentShader.error()); }
+        // Render latest state to hidden buffer, then swap buffers to show the result. Without
+        // a new state since last frame, the same one is drawn again, further interpolated.
+        {
+            auto timer = m_profiler.time(m_renderScope);
+            auto gpuTimer = m_profiler.time(m_gpuScope);
+            render(frame, tickFraction(SDL_GetPerformanceCounter(), frame.tickStart, m_tickLength));
+            if (m_recorder) { m_recorder->capture(); }
+            ++frames;
+        }
+        {
+            auto timer = m_profiler.time(m_swapScope);
+            SDL_GL_SwapWindow(m_window.get());
+        }
+        m_pacer.presented(frame.input);
+
+        // Finalize pass
+        {
+            auto timer = m_profiler.time(m_errorsScope);
+            processErrors("mainloop errors", pollErrors && !m_debugLog.active());
+        }
+        m_profiler.endFrame();
+    }
+}
 
-    m_program = gl::Program::link(vertexShader, fragmentShader);
-    if (m_program.hasError()) { throw std::runtime_error(m_program.error()); }
+int Application::benchmark()
+{
+    using clock = std::chrono::steady_clock;
+    const auto toMilliseconds = [](clock::duration value) {
+        return std::chrono::duration_cast<std::chrono::duration<float, std::milli>>(value).count();
+    };
+
+    // Render into a framebuffer object, which works whether the window shows or not
+    m_target = gl::Framebuffer(windowWidth, windowHeight);
+    m_target.bind();
+
+    // Warm up, waiting for shaders and letting the driver settle, without counting it
+    while (m_program == nullptr && !m_quit.load(std::memory_order_relaxed)) { render(snapshot(0), 0.0f); }
+    for (unsigned frame = 0; frame < Profiler::latency; ++frame) { render(snapshot(0), 0.0f); }
+    glFinish();
+
+    // Queries are reused in a ring, each result being read back when its query comes
+    // around again, by which time the GPU is done with it, like Profiler does
+    std::vector<gl::Query> gpuQueries(Profiler::latency);
+    std::vector<float> cpuTimes, gpuTimes;
+    cpuTimes.reserve(m_options.benchFrames);
+    gpuTimes.reserve(m_options.benchFrames);
+
+    // Time is simulated, as if every frame took exactly benchFrameTime
+    const auto frameLength = std::uint64_t(benchFrameTime) * SDL_GetPerformanceFrequency() / 1000;
+    std::uint64_t now = 0;
+
+    const auto start = clock::now();
+    for (unsigned frame = 0; frame < m_options.benchFrames; ++frame) {
+        if (m_quit.load(std::memory_order_relaxed)) { break; }
+        SDL_PumpEvents();
+
+        const auto frameStart = clock::now();
+        now += frameLength;
+        advance(frameLength);
+        const auto state = snapshot(now);
+        auto & query = gpuQueries[frame % gpuQueries.size()];
+        if (frame >= gpuQueries.size()) { gpuTimes.push_back(float(query.result()) / 1.0e6f); }
+        query.begin(gl::Query::target::TimeElapsed);
+        render(state, tickFraction(now, state.tickStart, m_tickLength));
+        gl::Query::end(gl::Query::target::TimeElapsed);
+        if (m_recorder) { m_recorder->capture(); }
+        cpuTimes.push_back(toMilliseconds(clock::now() - frameStart));
 
-    m_mvpLocation = glGetUniformLocation(m_program.id(), "mvp");
+        SDL_GL_SwapWindow(m_window.get());
+        processErrors("benchmark errors", false);
+    }
+    glFinish();
+    const auto seconds = toMilliseconds(clock::now() - start) / 1000.0f;
+    stopRecording();
+
+    // Collect results of last frames, whose queries did not come around again
+    const auto frames = cpuTimes.size();
+    for (auto frame = frames - std::min(frames, gpuQueries.size()); frame < frames; ++frame) {
+        gpuTimes.push_back(float(gpuQueries[frame % gpuQueries.size()].result()) / 1.0e6f);
+    }
+    if (cpuTimes.empty()) { return 1; }
+
+    // Mean and 95th percentile, the latter reordering samples
+    const auto statistics = [](std::vector<float> & samples) {
+        float sum = 0.0f;
+        for (auto value : samples) { sum += value; }
+        auto rank = samples.begin() + std::ptrdiff_t(samples.size() * 95 / 100);
+        std::nth_element(samples.begin(), rank, samples.end());
+        return std::make_pair(sum / float(samples.size()), *rank);
+    };
+    const auto cpu = statistics(cpuTimes);
+    const auto gpu = statistics(gpuTimes);
+
+    std::cout <<"frames " <<cpuTimes.size() <<", cubes " <<m_scene.size() <<'\n'
+              <<"fps " <<float(cpuTimes.size()) / seconds <<'\n'
+              <<"cpu ms " <<cpu.first <<" (p95 " <<cpu.second <<")\n"
+              <<"gpu ms " <<gpu.first <<" (p95 " <<gpu.second <<")" <<std::endl;
+    return 0;
+}
 
-    // Configure data array to read from cube data buffer
-    m_cube = loadCubeData();
+void Application::init()
+{
+    // Load shaders, from binaries saved by a previous run if possible. When the driver
+    // compiles in the background, carry on initializing and let render() pick them up.
+    if (!m_options.shaderCache.empty()) {
+        m_programs = gl::ProgramCache(m_options.shaderCache);
+    }
+    if (gl::Shader::isParallelSupported()) { gl::Shader::setCompilerThreads(~0u); }
+    // Optional shader features are compiled in or out, so the variant we use never tests them
+    m_programVariants = gl::ProgramVariants<feature>(m_programs, {
+        { gl::Shader::type::Vertex, shaders_vertex_glsl, shaders_vertex_glsl_len },
+        { gl::Shader::type::Fragment, shaders_fragment_glsl, shaders_fragment_glsl_len },
+    }, { "VERTEX_COLOR", "FOG", "LIGHTING" });
+    m_features = feature::VertexColor;
+    if (m_options.fog) { m_features = m_features | feature::Fog; }
+    if (m_options.lighting) { m_features = m_features | feature::Lighting; }
+    m_programVariants.prepare(m_features);
+
+    // Shader constants are read from uniform blocks, fed from a single buffer
+    m_camera = gl::UniformBlock<Camera>(0);
+
+    // Configure data array to read from cube mesh, converted at build time. Its index
+    // buffer becomes part of vertex array state, so the array must be bound first.
     m_array.bind();
-    m_array.setVertexAttrib(0, m_cube, 3, gl::type::Byte, true,     // Vertex data is 3x 1 signed byte
-                            sizeof(vertex), offsetof(vertex, x));
+    m_cube = Mesh::load(m_options.meshPath);
+    m_cube.bindIndices();
+    m_array.setVertexAttrib(0, m_cube.vertices(), 4, gl::type::Short, true, // Position is 4x 1 quantized short
+                            sizeof(MeshVertex), offsetof(MeshVertex, position));
     m_array.enableVertexAttrib(0, true);                            // Shader will see it at pos 0
-    m_array.setVertexAttrib(1, m_cube, 3, gl::type::UByte, true,    // Color data is 3x 1 unsigned byte
-                            sizeof(vertex), offsetof(vertex, color));
+    m_array.setVertexAttrib(1, m_cube.vertices(), 3, gl::type::UByte, true, // Color data is 3x 1 unsigned byte
+                            sizeof(MeshVertex), offsetof(MeshVertex, color));
     m_array.enableVertexAttrib(1, true);                            // Shader will see it at pos 1
+    m_array.setVertexAttrib(6, m_cube.vertices(), 4, gl::type::Int2101010, true, // Normal is packed in 4 bytes
+                            sizeof(MeshVertex), offsetof(MeshVertex, normal));
+    m_array.enableVertexAttrib(6, true);                            // After instance matrix at 2 to 5
+
+    // Lay out cubes on a grid facing the camera, alternating rotation direction and axis
+    const auto grid = gridSize(m_options.instances);
+    const auto halfWidth = float(grid.first) * cubeSpacing / 2.0f;
+    const auto halfHeight = float(grid.second) * cubeSpacing / 2.0f;
+    const auto tanHalfFov = std::tan(fieldOfView / 2.0f);
+    const auto distance = std::max(halfWidth / (tanHalfFov * aspectRatio),
+                                   halfHeight / tanHalfFov) + cubeSpacing / 2.0f;
+    const auto spin = 2.0f * glm::pi<float>() / 5.0f;
+    const auto tumble = 2.0f * glm::pi<float>() / 50.0f;
+
+    m_scene.reserve(m_options.instances);
+    for (unsigned idx = 0; idx < m_options.instances; ++idx) {
+        const bool odd = idx % 2 != 0;
+        const auto column = idx % grid.first, row = idx / grid.first;
+        m_scene.add({ (float(column) + 0.5f) * cubeSpacing - halfWidth,
+                      halfHeight - (float(row) + 0.5f) * cubeSpacing,
+                      -distance },
+                    odd ? spin : -spin,
+                    odd ? glm::vec3{0.0f, 0.0f, 1.0f} : glm::vec3{1.0f, 0.0f, 0.0f},
+                    tumble);
+    }
+
+    // Prepare a projection matrix - converting from 3D space into 2D position
+    m_viewProjection = glm::perspective(fieldOfView, aspectRatio,
+                                        distance - cubeSpacing, distance + cubeSpacing);
+
+    // Configure instance array, one 4x4 matrix per cube, spread over 4 attributes.
+    // Transforms are written straight into GPU memory, persistently mapped if possible.
+    // Culling reads them as shader storage, whose offsets may need stricter alignment.
+    const auto instanceSize = m_scene.size() * sizeof(glm::mat4);
+    if (gl::VertexStreamBuffer::isSupported()) {
+        const bool culling = m_options.culling && Culler::isSupported();
+        m_stream = gl::VertexStreamBuffer(instanceSize, 3, culling
+                                          ? std::max(sizeof(glm::mat4), Culler::offsetAlignment())
+                                          : sizeof(glm::mat4));
+        setInstanceBuffer(m_stream.buffer(), 0);
+    } else {
+        m_instances.bind();
+        m_instances.setData(nullptr, instanceSize, gl::VertexBuffer::usage::StreamDraw);
+        setInstanceBuffer(m_instances, 0);
+    }
+    for (GLuint column = 0; column < 4; ++column) {
+        m_array.enableVertexAttrib(2 + column, true);
+        m_array.setVertexAttribDivisor(2 + column, 1);              // Advance once per cube
+    }
+
+    // Describe draws in a buffer, so the whole scene is submitted in a single call
+    // regardless of how many meshes it holds. Commands could also be written by shaders.
+    if (gl::VertexArray::isIndirectSupported()) {
+        const gl::DrawElementsIndirectCommand commands[] = {
+            { m_cube.indexCount(), GLuint(m_scene.size()), 0, 0, 0 }, // All cubes at once
+        };
+        m_commands.bind();
+        m_commands.setData(commands, sizeof(commands), gl::DrawIndirectBuffer::usage::StaticDraw);
+    }
+
+    // Let the GPU skip cubes out of view, instance attributes then read the compacted
+    // list of visible transforms it outputs, and the draw command is generated as well.
+    if (m_options.culling) {
+        if (Culler::isSupported()) {
+            m_culler = Culler(m_scene.size(), m_cube.indexCount(), m_cube.radius(), 1, m_programs);
+            setInstanceBuffer(m_culler.visible(), 0);
+        } else {
+            std::cerr <<"GPU culling requires OpenGL 4.3, disabling it" <<std::endl;
+        }
+    }
+    std::cerr <<"Computing transforms on " <<m_workers.size() <<" threads, "
+              <<(m_stream.valid() ? "persistently mapped" : "mapped per frame") <<", "
+              <<(m_culler.valid() ? "culled on GPU" :
+                 m_commands.size() > 0 ? "indirect draws" : "direct draws") <<std::endl;
+    std::cerr <<"Cube mesh: " <<m_cube.vertexCount() <<" vertices, " <<m_cube.indexCount() / 3
+              <<" triangles, " <<(m_cube.indexType() == gl::type::UShort ? 16 : 32) <<"-bit indices" <<std::endl;
+    std::cerr <<"Shader cache: " <<(m_programs.enabled() ? m_options.shaderCache : "disabled") <<", "
+              <<m_programs.counters().hits <<" programs loaded, "
+              <<m_programs.counters().misses <<" compiled" <<std::endl;
+
+    // Benchmarks keep V-sync off and run uncapped, anything else follows options
+    if (m_options.benchFrames == 0) {
+        m_pacer = FramePacer(m_options.vsync, m_options.maxFrameRate);
+        static const char * const modes[] = { "off", "on", "adaptive" };
+        std::cerr <<"V-sync " <<modes[int(m_pacer.mode())];
+        if (m_options.maxFrameRate > 0) { std::cerr <<", capped at " <<m_options.maxFrameRate <<" frames/s"; }
+        std::cerr <<std::endl;
+    }
 
+    // Frames are read back into buffers the GPU fills on its own time, and encoded elsewhere
+    if (!m_options.capturePath.empty()) {
+        m_recorder = std::make_unique<Recorder>(m_options.capturePath, windowWidth, windowHeight);
+        std::cerr <<"Recording frames to " <<m_options.capturePath <<", as "
+                  <<(m_recorder->type() == Recorder::format::Png ? "PNG images" : "raw video")
+                  <<std::endl;
+    }
 
-    if (!processErrors("initialization errors")) {
+    if (!processErrors("initialization errors", true)) {
         throw std::runtime_error("Application() failed");
     }
 }
 
-void Application::update(milliseconds ms)
+void Application::advance(std::uint64_t elapsed)
 {
-    m_angle += 200 * ms.count() / 1000;
-    if (m_angle >= 10000) { m_angle -= 10000; }
+    const auto limit = std::uint64_t(maxCatchUp) * SDL_GetPerformanceFrequency() / 1000;
+    m_accumulator = std::min(m_accumulator + elapsed, std::max(limit, m_tickLength));
+    while (m_accumulator >= m_tickLength) {
+        update();
+        m_accumulator -= m_tickLength;
+    }
 }
 
-void Application::render()
+void Application::update()
+{
+    // Both states wrap together, so interpolating between them never goes backwards
+    m_previousTime = m_time;
+    m_time += 1.0 / double(m_options.tickRate);
+    if (m_time >= scenePeriod) {
+        m_time -= scenePeriod;
+        m_previousTime -= scenePeriod;
+    }
+}
+
+Application::Frame Application::snapshot(std::uint64_t now) const
+{
+    return { m_previousTime, m_time, now - m_accumulator, m_lastInput, m_visible };
+}
+
+void Application::render(const Frame & frame, float alpha)
 {
     // Reset rendering
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); // clear buffers
-    glEnable(GL_CULL_FACE);     // filter out back-facing primitives
-    glEnable(GL_DEPTH_TEST);    // enable depth testing, hiding pixels behind other shapes
-    glDepthFunc(GL_LESS);       // tell OpenGL "before" means "with lower depth value"
-    m_program.enable();         // enable our shaders
 
-    // Prepare a projection matrix - converting from 3D space into 2D position
-    auto projection = glm::perspective(glm::radians(45.0f), 4.0f/3.0f, 0.1f, 100.0f);
+    // Show empty frames until shaders are ready, rather than freezing
+    if (m_program == nullptr) {
+        if (!m_programVariants.ready(m_features)) { return; }
+        m_program = &m_programVariants.get(m_features);
+        m_camera.attach(*m_program, "Camera");
+    }
 
-    // Draw right cube
-    auto model = glm::translate(glm::mat4(1), {2.0f, 0.0f, -8.0f});
-    model = glm::rotate(model, 2.0f * glm::pi<float>() * float(m_angle) / 1000.0f, {0.0f, 1.0f, 0.0f});
-    model = glm::rotate(model, 2.0f * glm::pi<float>() * float(m_angle) / 10000.0f, {0.0f, 0.0f, 1.0f});
+    m_state.enable(gl::capability::CullFace);   // filter out back-facing primitives
+    m_state.enable(gl::capability::DepthTest);  // enable depth testing, hiding pixels behind other shapes
+    m_state.depthFunc(GL_LESS);                 // tell OpenGL "before" means "with lower depth value"
+
+    // Upload all shader constants at once, then point each draw at its own slot
+    m_camera.clear();
+    const auto cameraSlot = m_camera.push({ m_viewProjection, m_cube.positionScale(), m_cube.positionBias() });
+    m_camera.upload();
+    m_camera.bind(cameraSlot);
+
+    // Get GPU memory for this frame's transforms
+    const auto instanceSize = m_scene.size() * sizeof(glm::mat4);
+    glm::mat4 * transforms;
+    std::size_t instanceOffset = 0;
+    if (m_stream.valid()) {
+        m_stream.beginFrame();
+        auto chunk = m_stream.allocate(instanceSize, m_stream.alignment());
+        if (!m_culler.valid()) { setInstanceBuffer(m_stream.buffer(), chunk.offset); }
+        transforms = chunk.as<glm::mat4>();
+        instanceOffset = chunk.offset;
+    } else {
+        // Invalidating lets the driver hand out fresh memory while the GPU reads last frame's
+        m_instances.bind();
+        transforms = static_cast<glm::mat4 *>(m_instances.map(
+            0, instanceSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+        ));
+    }
 
-    auto mvp = projection * model;
-    glUniformMatrix4fv(m_mvpLocation, 1, GL_FALSE, &mvp[0][0]);
-    m_array.draw(gl::primitive::Triangles, {0, 36});
+    // Compute all transforms in parallel, at a time between the last two ticks so motion
+    // stays smooth whatever the frame rate, then draw all cubes in a single call
+    const auto time = frame.previous + double(alpha) * (frame.current - frame.previous);
+    m_scene.computeTransforms(float(time), transforms, m_workers);
+    if (!m_stream.valid()) { m_instances.unmap(); }
+    if (m_culler.valid()) {
+        m_culler.cull(m_viewProjection, m_stream.valid() ? m_stream.buffer() : m_instances,
+                      instanceOffset, m_scene.size());
+    }
 
-    // Draw left cube
-    model = glm::translate(glm::mat4(1), {-2.0f, 0.0f, -8.0f});
-    model = glm::rotate(model, -2.0f * glm::pi<float>() * float(m_angle) / 1000.0f, {0.0f, 1.0f, 0.0f});
-    model = glm::rotate(model, 2.0f * glm::pi<float>() * float(m_angle) / 10000.0f, {1.0f, 0.0f, 0.0f});
+    m_program->enable();                        // enable our shaders
+    if (m_culler.valid()) {
+        m_culler.commands().bind();
+        m_array.drawIndicesIndirect(gl::primitive::Triangles, m_cube.indexType(),
+                                    m_culler.commands(), 0, 1);
+    } else if (m_commands.size() > 0) {
+        m_commands.bind();
+        m_array.drawIndicesIndirect(gl::primitive::Triangles, m_cube.indexType(), m_commands, 0, 1);
+    } else {
+        m_array.drawIndicesInstanced(gl::primitive::Triangles, m_cube.indexType(),
+                                     {0, GLsizei(m_cube.indexCount())}, GLsizei(m_scene.size()));
+    }
+    if (m_stream.valid()) { m_stream.endFrame(); }
+}
 
-    mvp = projection * model;
-    glUniformMatrix4fv(m_mvpLocation, 1, GL_FALSE, &mvp[0][0]);
-    m_array.draw(gl::primitive::Triangles, {0, 36});
+void Application::stopRecording()
+{
+    if (!m_recorder) { return; }
+    m_recorder->finish();
+    const auto counters = m_recorder->counters();
+    std::cerr <<"Recorded " <<counters.written <<" of " <<counters.captured <<" frames, "
+              <<counters.dropped <<" dropped, readback waited " <<counters.stalls <<" times" <<std::endl;
+    m_recorder = nullptr;
 }
 
-bool Application::processErrors(const char * ctx)
+void Application::setInstanceBuffer(gl::VertexBuffer & buffer, std::size_t offset)
 {
-    auto err = glGetError();
-    if (err == GL_NO_ERROR) { return true; }
+    for (GLuint column = 0; column < 4; ++column) {
+        m_array.setVertexAttrib(2 + column, buffer, 4, gl::type::Float, false, sizeof(glm::mat4),
+                                GLsizei(offset + column * sizeof(glm::vec4)));
+    }
+}
 
-    // There may be several errors, loop until we got all of them
-    std::cerr <<ctx <<": \n";
-    do {
-        auto error = gl::error(err);
-        std::cerr <<'\t' <<error.what() <<std::endl;
-        err = glGetError();
-    } while(err != GL_NO_ERROR);
-    return false;
+bool Application::processErrors(const char * ctx, bool poll)
+{
+    bool success = true;
+    bool header = false;
+    const auto report = [&]() -> std::ostream & {
+        if (!header) { std::cerr <<ctx <<": \n"; header = true; }
+        return std::cerr;
+    };
+
+    // Debug messages come in asynchronously, just print those received so far
+    if (m_debugLog.active()) {
+        auto messages = m_debugLog.take();
+        auto dropped = m_debugLog.takeDropped();
+        for (const auto & message : messages) {
+            report() <<'\t' <<gl::DebugLog::severityName(message.severity) <<' '
+                     <<gl::DebugLog::sourceName(message.source) <<' '
+                     <<gl::DebugLog::typeName(message.type) <<" #" <<message.id
+                     <<": " <<message.text <<'\n';
+            if (message.isError()) { success = false; }
+        }
+        if (dropped > 0) { report() <<'\t' <<dropped <<" more messages dropped\n"; }
+    }
+
+    // glGetError() makes the CPU wait for the driver, so only use it when asked to. It also
+    // catches errors whose debug message has not come in yet. There may be several errors,
+    // loop until we got all of them.
+    if (poll) {
+        for (auto err = glGetError(); err != GL_NO_ERROR; err = glGetError()) {
+            report() <<'\t' <<gl::error(err).what() <<'\n';
+            success = false;
+        }
+    }
+
+    if (header) { std::cerr <<std::flush; }
+    return success;
 }
 
 /****************************************************************************/
@@ -194,12 +635,19 @@ void Application::quit()
     m_quit.store(true, std::memory_order_relaxed);
 }
 
-sdl_ptr<SDL_Window> Application::createWindow(const std::string & name)
+sdl_ptr<SDL_Window> Application::createWindow(const std::string & name, bool debug, bool hidden)
 {
+#ifndef NDEBUG
+    debug = true;                                           // always report issues in debug builds
+#endif
     SDL_GL_ResetAttributes();
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);   // we want OpenGL 3
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);   // actually, OpenGL 3.3
     SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);      // with hardware support
+    if (debug) {
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS,           // with full driver diagnostics
+                            SDL_GL_CONTEXT_DEBUG_FLAG);
+    }
 
     SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);                // 8-bit red channel
     SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);              // 8-bit green channel
@@ -209,67 +657,12 @@ sdl_ptr<SDL_Window> Application::createWindow(const std::string & name)
     auto window = sdl_ptr<SDL_Window>(SDL_CreateWindow(
         name.c_str(),
         SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-        800, 600,
-        SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN // | SDL_WINDOW_RESIZABLE
+        windowWidth, windowHeight,
+        SDL_WINDOW_OPENGL | (hidden ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN) // | SDL_WINDOW_RESIZABLE
     ));
     if (!window) { throw std::runtime_error(SDL_GetError()); }
 
     SDL_GL_CreateContext(window.get());                     // enable OpenGL engine
-    SDL_GL_SetSwapInterval(1);                              // enable V-sync
+    SDL_GL_SetSwapInterval(hidden ? 0 : 1);                 // enable V-sync, unless nobody watches
     return window;
 }
-
-/****************************************************************************/
-
-static constexpr std::array<vertex, 36> cubeVertice = {{
-    // Left side
-    { -127,-127,-127, { 0, 0, 255 }},
-    { -127,-127, 127, { 255, 0, 255 }},
-    { -127, 127, 127, { 255, 0, 0 }},
-    { -127,-127,-127, { 0, 0, 255 }},
-    { -127, 127, 127, { 255, 0, 0 }},
-    { -127, 127,-127, { 255, 0, 255 }},
-    // Back side
-    { 127, 127,-127,  { 0, 255, 0 }},
-    { -127,-127,-127, { 0, 0, 255 }},
-    { -127, 127,-127, { 0, 255, 255 }},
-    { 127, 127,-127,  { 0, 255, 0 }},
-    { 127,-127,-127,  { 0, 255, 255 }},
-    { -127,-127,-127, { 0, 0, 255 }},
-    // Down side
-    { 127,-127, 127,  { 255, 0, 0 }},
-    { -127,-127,-127, { 0, 255, 0 }},
-    { 127,-127,-127,  { 255, 255, 0 }},
-    { 127,-127, 127,  { 255, 0, 0 }},
-    { -127,-127, 127, { 255, 255, 0 }},
-    { -127,-127,-127, { 0, 255, 0 }},
-    // Front side
-    { -127, 127, 127, { 192, 192, 0 }},
-    { -127,-127, 127, { 0, 255, 0 }},
-    { 127,-127, 127,  { 0, 192, 192 }},
-    { 127, 127, 127,  { 0, 255, 0 }},
-    { -127, 127, 127, { 192, 192, 0 }},
-    { 127,-127, 127,  { 0, 192, 192 }},
-    // Right side
-    { 127, 127, 127,  { 192, 0, 192 }},
-    { 127,-127,-127,  { 192, 192, 0 }},
-    { 127, 127,-127,  { 255, 0, 0 }},
-    { 127,-127,-127,  { 192, 192, 0 }},
-    { 127, 127, 127,  { 192, 0, 192 }},
-    { 127,-127, 127,  { 255, 0, 0 }},
-    // Top side
-    { 127, 127, 127,  { 0, 192, 192 }},
-    { 127, 127,-127,  { 192, 0, 192 }},
-    { -127, 127,-127, { 0, 0, 255 }},
-    { 127, 127, 127,  { 0, 192, 192 }},
-    { -127, 127,-127, { 0, 0, 255 }},
-    { -127, 127, 127, { 192, 0, 192 }}
-}};
-
-static gl::VertexBuffer loadCubeData()
-{
-    gl::VertexBuffer buffer;
-    buffer.bind();
-    buffer.setData(cubeVertice, gl::VertexBuffer::usage::StaticDraw);
-    return buffer;
-}
@@ -0,0 +1,90 @@
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <glm/geometric.hpp>
+#include <glm/vec4.hpp>
+#include <cassert>
+#include "Culler.h"
+#include "resources.h"
+
+constexpr GLuint Culler::groupSize;
+
+/****************************************************************************/
+
+Culler::Culler(std::size_t capacity, GLuint indices, float radius, GLuint binding,
+               gl::ProgramCache & programs)
+ : m_capacity(capacity),
+   m_indices(indices),
+   m_radius(radius),
+   m_frustum(binding)
+{
+    m_program = programs.link({
+        { gl::Shader::type::Compute, shaders_cull_glsl, shaders_cull_glsl_len },
+    });
+    m_frustum.attach(m_program, "Frustum");
+
+    m_alignment = offsetAlignment();
+
+    // Only ever written by the GPU
+    m_visible.bind();
+    m_visible.setData(nullptr, capacity * sizeof(glm::mat4), gl::VertexBuffer::usage::DynamicCopy);
+
+    const gl::DrawElementsIndirectCommand command = { indices, 0, 0, 0, 0 };
+    m_commands.bind();
+    m_commands.setData(&command, sizeof(command), gl::DrawIndirectBuffer::usage::DynamicDraw);
+}
+
+bool Culler::isSupported()
+{
+    return gl::hasVersion(4, 3);
+}
+
+std::size_t Culler::offsetAlignment()
+{
+    GLint alignment = 1;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return std::size_t(alignment);
+}
+
+void Culler::cull(const glm::mat4 & viewProjection, const gl::VertexBuffer & instances,
+                  std::size_t offset, std::size_t count)
+{
+    assert(valid());
+    assert(count <= m_capacity);
+    assert(offset % m_alignment == 0);
+
+    // Extract frustum planes from the combined matrix, as rows of clip space tests:
+    // a point is inside if -w <= x, y, z <= w, that is w + x >= 0, w - x >= 0, ...
+    Frustum frustum;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int sign = 0; sign < 2; ++sign) {
+            glm::vec4 plane;
+            for (int col = 0; col < 4; ++col) {
+                plane[col] = viewProjection[col][3] + (sign == 0 ? 1.0f : -1.0f) * viewProjection[col][axis];
+            }
+            frustum.planes[std::size_t(2 * axis + sign)] = plane / glm::length(glm::vec3(plane.x, plane.y, plane.z));
+        }
+    }
+    frustum.radius = m_radius;
+    frustum.count = GLuint(count);
+
+    m_frustum.clear();
+    const auto slot = m_frustum.push(frustum);
+    m_frustum.upload();
+    m_frustum.bind(slot);
+
+    // Shader counts visible instances into the command, start from zero
+    const gl::DrawElementsIndirectCommand command = { m_indices, 0, 0, 0, 0 };
+    m_commands.bind();
+    m_commands.setData(&command, sizeof(command), 0);
+
+    instances.bindRange(gl::target::ShaderStorage, 0, offset, count * sizeof(glm::mat4));
+    m_visible.bindRange(gl::target::ShaderStorage, 1, 0, m_capacity * sizeof(glm::mat4));
+    m_commands.bindRange(gl::target::ShaderStorage, 2, 0, sizeof(command));
+
+    m_program.enable();
+    m_program.dispatch(GLuint((count + groupSize - 1) / groupSize));
+
+    // Make results visible to the draw command and vertex fetching
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
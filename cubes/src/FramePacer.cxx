@@ -0,0 +1,72 @@
+#include <SDL.h>
+#include <algorithm>
+#include <thread>
+#include "FramePacer.h"
+
+/// Time spent spinning rather than sleeping before a frame deadline, in microseconds.
+/// Covers the usual oversleep of SDL_Delay() and of the scheduler waking us up.
+static constexpr std::uint64_t spinTime = 2000;
+
+
+FramePacer::FramePacer(sync mode, unsigned maxRate)
+ : m_mode(mode)
+{
+    const int intervals[] = { 0, 1, -1 };
+    if (SDL_GL_SetSwapInterval(intervals[int(mode)]) < 0 && mode == sync::Adaptive) {
+        SDL_GL_SetSwapInterval(1);                  // adaptive V-sync not supported, fall back
+        m_mode = sync::On;
+    }
+
+    const auto frequency = SDL_GetPerformanceFrequency();
+    if (maxRate > 0) { m_period = std::max<std::uint64_t>(1, frequency / maxRate); }
+    m_spin = spinTime * frequency / 1000000;
+    m_latencies.reserve(latencySamples);
+}
+
+void FramePacer::waitFrame()
+{
+    if (m_period == 0) { return; }
+    auto now = SDL_GetPerformanceCounter();
+
+    // A frame more than a period late is not made up for by rushing the next ones
+    if (m_deadline == 0 || now > m_deadline + m_period) { m_deadline = now; }
+
+    while (now < m_deadline) {
+        const auto remaining = m_deadline - now;
+        if (remaining > m_spin) {
+            const auto frequency = SDL_GetPerformanceFrequency();
+            SDL_Delay(Uint32((remaining - m_spin) * 1000 / frequency));
+        } else {
+            std::this_thread::yield();
+        }
+        now = SDL_GetPerformanceCounter();
+    }
+    m_deadline += m_period;
+}
+
+void FramePacer::presented(std::uint64_t input)
+{
+    if (input == 0 || input == m_lastInput) { return; }
+    m_lastInput = input;
+
+    const auto latency = float(double(SDL_GetPerformanceCounter() - input) * 1000.0
+                               / double(SDL_GetPerformanceFrequency()));
+    if (m_latencies.size() < latencySamples) {
+        m_latencies.push_back(latency);
+    } else {
+        m_latencies[m_inputs % latencySamples] = latency;
+    }
+    ++m_inputs;
+}
+
+FramePacer::Latency FramePacer::latency() const
+{
+    if (m_latencies.empty()) { return { 0, 0.0f, 0.0f }; }
+
+    auto samples = m_latencies;
+    float sum = 0.0f;
+    for (auto value : samples) { sum += value; }
+    auto rank = samples.begin() + std::ptrdiff_t(samples.size() * 95 / 100);
+    std::nth_element(samples.begin(), rank, samples.end());
+    return { m_inputs, sum / float(samples.size()), *rank };
+}
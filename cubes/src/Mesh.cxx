@@ -0,0 +1,102 @@
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Mesh.h"
+#include "MeshFile.h"
+
+/// Read-only mapping of a whole file, unmapped on destruction
+class FileMapping final
+{
+public:
+    explicit FileMapping(const std::string & path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) { throw std::runtime_error(path + ": " + std::strerror(errno)); }
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            m_size = std::size_t(info.st_size);
+            m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        const auto error = errno;
+        ::close(fd);                                // mapping outlives the descriptor
+        if (m_data == MAP_FAILED) { throw std::runtime_error(path + ": " + std::strerror(error)); }
+        ::madvise(m_data, m_size, MADV_SEQUENTIAL); // read ahead, driver copies front to back
+    }
+    FileMapping(const FileMapping &) = delete;
+    ~FileMapping() { if (m_data != MAP_FAILED) { ::munmap(m_data, m_size); } }
+
+    const unsigned char * data() const noexcept { return static_cast<const unsigned char *>(m_data); }
+    std::size_t size() const noexcept { return m_size; }
+
+private:
+    void *      m_data = MAP_FAILED;                ///< Start of mapping
+    std::size_t m_size = 0;                         ///< Size of file and mapping
+};
+
+/****************************************************************************/
+
+Mesh Mesh::load(const std::string & path)
+{
+    const FileMapping file(path);
+    const auto failure = [&path](const std::string & reason) {
+        return std::runtime_error(path + ": " + reason);
+    };
+
+    // Only the header is copied, to read it without alignment concerns
+    MeshFileHeader header;
+    if (file.size() < sizeof(header)) { throw failure("not a mesh file"); }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, meshFileMagic, sizeof(meshFileMagic)) != 0) {
+        throw failure("not a mesh file");
+    }
+    if (header.version != meshFileVersion) {
+        throw failure("unsupported mesh file version " + std::to_string(header.version));
+    }
+    if (header.vertexSize != sizeof(MeshVertex)) { throw failure("unsupported vertex layout"); }
+    if (header.indexSize != 2 && header.indexSize != 4) { throw failure("unsupported index size"); }
+
+    // Offsets come from the file, check blocks fit without overflowing
+    const auto vertexBytes = std::uint64_t(header.vertexCount) * header.vertexSize;
+    const auto indexBytes = std::uint64_t(header.indexCount) * header.indexSize;
+    if (header.vertexOffset % meshFileAlignment != 0 || header.indexOffset % meshFileAlignment != 0
+        || header.vertexOffset > file.size() || vertexBytes > file.size() - header.vertexOffset
+        || header.indexOffset > file.size() || indexBytes > file.size() - header.indexOffset) {
+        throw failure("truncated or corrupted mesh file");
+    }
+    if (header.indexCount == 0 || header.indexCount % 3 != 0) { throw failure("no triangles"); }
+
+    // Out of range indices would have the GPU read past the vertex buffer. Checking them
+    // is a single pass over memory the driver is about to read anyway.
+    const auto outOfRange = [&](auto index) {
+        const auto indices = reinterpret_cast<const decltype(index) *>(file.data() + header.indexOffset);
+        for (std::uint32_t idx = 0; idx < header.indexCount; ++idx) {
+            if (indices[idx] >= header.vertexCount) { return true; }
+        }
+        return false;
+    };
+    if (header.indexSize == 2 ? outOfRange(std::uint16_t()) : outOfRange(std::uint32_t())) {
+        throw failure("index out of range");
+    }
+
+    Mesh mesh;
+    mesh.m_vertexCount = header.vertexCount;
+    mesh.m_indexCount = header.indexCount;
+    mesh.m_indexType = header.indexSize == 2 ? gl::type::UShort : gl::type::UInt;
+    mesh.m_radius = header.radius;
+    std::memcpy(mesh.m_positionScale, header.positionScale, sizeof(header.positionScale));
+    std::memcpy(mesh.m_positionBias, header.positionBias, sizeof(header.positionBias));
+    mesh.m_vertices.bind();
+    mesh.m_vertices.setData(file.data() + header.vertexOffset, std::size_t(vertexBytes),
+                            gl::VertexBuffer::usage::StaticDraw);
+    mesh.m_indices.bind();
+    mesh.m_indices.setData(file.data() + header.indexOffset, std::size_t(indexBytes),
+                           gl::ElementBuffer::usage::StaticDraw);
+    return mesh;
+}
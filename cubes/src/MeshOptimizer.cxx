@@ -0,0 +1,127 @@
+// CPU side of Mesh, kept apart so the build-time mesh converter needs no OpenGL library
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <cassert>
+#include <cstdint>
+#include "Mesh.h"
+
+constexpr unsigned Mesh::cacheSize;
+constexpr GLuint Mesh::invalid;
+
+/****************************************************************************/
+
+std::size_t Mesh::hash(const void * data, std::size_t size)
+{
+    // FNV-1a, vertices are small and this is only run at load time
+    auto bytes = static_cast<const unsigned char *>(data);
+    auto hash = std::uint64_t(0xcbf29ce484222325u);
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        hash = (hash ^ bytes[idx]) * 0x100000001b3u;
+    }
+    return std::size_t(hash ^ (hash >> 32));
+}
+
+void Mesh::optimizeVertexCache(std::vector<GLuint> & indices, std::size_t vertexCount)
+{
+    assert(indices.size() % 3 == 0);
+    const auto triangleCount = indices.size() / 3;
+
+    // Triangles using every vertex, as a flat list with one range per vertex
+    std::vector<GLuint> live(vertexCount, 0);
+    for (auto index : indices) { ++live[index]; }
+    std::vector<std::size_t> first(vertexCount + 1, 0);
+    for (std::size_t vertex = 0; vertex < vertexCount; ++vertex) {
+        first[vertex + 1] = first[vertex] + live[vertex];
+    }
+    std::vector<GLuint> adjacency(indices.size());
+    {
+        auto next = first;
+        for (std::size_t idx = 0; idx < indices.size(); ++idx) {
+            adjacency[next[indices[idx]]++] = GLuint(idx / 3);
+        }
+    }
+
+    // Tipsify: fan out around a vertex, emitting all its triangles, then move on to
+    // the candidate that will still be in cache, or fall back to a dead-end vertex
+    std::vector<GLuint> result;
+    result.reserve(indices.size());
+    std::vector<std::size_t> cacheTime(vertexCount, 0);    // Timestamp of entering cache
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<GLuint> deadEnds, candidates;
+    std::size_t time = cacheSize + 1, cursor = 0;
+
+    auto fan = vertexCount > 0 ? GLuint(0) : invalid;
+    while (fan != invalid) {
+        candidates.clear();
+        for (auto pos = first[fan]; pos < first[fan + 1]; ++pos) {
+            const auto triangle = adjacency[pos];
+            if (emitted[triangle]) { continue; }
+            emitted[triangle] = true;
+            for (std::size_t corner = 0; corner < 3; ++corner) {
+                const auto vertex = indices[3 * triangle + corner];
+                result.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                --live[vertex];
+                if (time - cacheTime[vertex] > cacheSize) { cacheTime[vertex] = time++; }
+            }
+        }
+
+        // Prefer the oldest candidate that stays in cache while its triangles are emitted
+        fan = invalid;
+        std::size_t bestPriority = 0;
+        for (auto vertex : candidates) {
+            if (live[vertex] == 0) { continue; }
+            std::size_t priority = 1;
+            if (time - cacheTime[vertex] + 2 * live[vertex] <= cacheSize) {
+                priority = time - cacheTime[vertex] + 1;
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fan = vertex;
+            }
+        }
+        if (fan != invalid) { continue; }
+
+        // Dead end: resume from a recently used vertex, or from the next one in order
+        while (!deadEnds.empty() && fan == invalid) {
+            if (live[deadEnds.back()] > 0) { fan = deadEnds.back(); }
+            deadEnds.pop_back();
+        }
+        while (cursor < vertexCount && fan == invalid) {
+            if (live[cursor] > 0) { fan = GLuint(cursor); }
+            ++cursor;
+        }
+    }
+    assert(result.size() == indices.size());
+    indices = std::move(result);
+}
+
+float Mesh::cacheMissRatio(const std::vector<GLuint> & indices, std::size_t vertexCount)
+{
+    if (indices.empty()) { return 0.0f; }
+
+    // Entries stay in cache for cacheSize misses, so a timestamp tells whether they are there
+    std::vector<std::size_t> cacheTime(vertexCount, 0);
+    std::size_t misses = 0;
+    for (auto index : indices) {
+        if (cacheTime[index] == 0 || misses - cacheTime[index] >= cacheSize) {
+            cacheTime[index] = ++misses;
+        }
+    }
+    return float(misses) / float(indices.size() / 3);
+}
+
+std::vector<GLuint> Mesh::fetchOrder(std::vector<GLuint> & indices, std::size_t vertexCount,
+                                     std::size_t & used)
+{
+    std::vector<GLuint> order(vertexCount, invalid);
+    GLuint next = 0;
+    for (auto & index : indices) {
+        if (order[index] == invalid) { order[index] = next++; }
+        index = order[index];
+    }
+    used = next;
+    return order;
+}
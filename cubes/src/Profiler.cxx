@@ -0,0 +1,184 @@
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include "Profiler.h"
+
+using std::chrono::duration;
+
+/// Convert a duration to fractional milliseconds
+template <typename Rep, typename Period> static float toMilliseconds(duration<Rep, Period> value)
+{
+    return std::chrono::duration_cast<duration<float, std::milli>>(value).count();
+}
+
+/****************************************************************************/
+
+Profiler::Timer::Timer(Profiler & profiler, scope_id id)
+ : m_profiler(profiler.enabled() ? &profiler : nullptr),
+   m_id(id)
+{
+    if (m_profiler == nullptr) { return; }
+    if (m_profiler->m_scopes[m_id].type == kind::Gpu) {
+        m_profiler->start(m_id);
+    } else {
+        m_start = clock::now();
+    }
+}
+
+Profiler::Timer::~Timer()
+{
+    if (m_profiler != nullptr) { m_profiler->stop(m_id, m_start); }
+}
+
+/****************************************************************************/
+
+Profiler::Profiler(unsigned period, const std::string & csvPath)
+ : m_period(period)
+{
+    if (period == 0) { return; }
+    m_frames.resize(latency);
+    if (!csvPath.empty()) {
+        m_csv.open(csvPath, std::ios::out | std::ios::trunc);
+        if (!m_csv) { throw std::runtime_error("cannot open " + csvPath); }
+        m_csv <<"frame,scope,samples,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,gpu_bound\n";
+    }
+    m_cpuFrame = addScope("frame", kind::Wait);
+    m_gpuFrame = addScope("gpu frame", kind::Gpu);
+}
+
+Profiler::scope_id Profiler::addScope(std::string name, kind type)
+{
+    m_scopes.push_back({ std::move(name), type, {} });
+    return scope_id(m_scopes.size() - 1);
+}
+
+void Profiler::start(scope_id id)
+{
+    auto & frame = m_frames[m_frame];
+    if (frame.used == frame.samples.size()) { frame.samples.push_back({ id, gl::Query() }); }
+    auto & sample = frame.samples[frame.used++];
+    sample.id = id;
+    sample.query.begin(gl::Query::target::TimeElapsed);
+}
+
+void Profiler::stop(scope_id id, clock::time_point start)
+{
+    auto & scope = m_scopes[id];
+    if (scope.type == kind::Gpu) {
+        gl::Query::end(gl::Query::target::TimeElapsed);
+        return;
+    }
+    auto elapsed = toMilliseconds(clock::now() - start);
+    if (scope.type == kind::Background) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        scope.samples.push_back(elapsed);
+        return;
+    }
+    scope.samples.push_back(elapsed);
+    if (scope.type == kind::Work) { m_work += elapsed; }
+}
+
+void Profiler::endFrame()
+{
+    if (!enabled()) { return; }
+
+    auto now = clock::now();
+    if (m_frameCount > 0) {
+        m_scopes[m_cpuFrame].samples.push_back(toMilliseconds(now - m_lastFrame));
+    }
+    m_lastFrame = now;
+
+    // Stamp current frame, then move on to the oldest one, which should be complete by now
+    auto & frame = m_frames[m_frame];
+    frame.end.timestamp();
+    frame.pending = true;
+    frame.work = m_work;
+    m_work = 0.0f;
+
+    m_frame = (m_frame + 1) % latency;
+    collect(m_frames[m_frame]);
+
+    if (++m_frameCount % m_period == 0) { report(); }
+}
+
+void Profiler::collect(Frame & frame)
+{
+    if (!frame.pending) { return; }
+    frame.pending = false;
+
+    // Queries complete in order, so if the end stamp is there, everything is.
+    // Otherwise the GPU is more than latency frames behind: drop the frame rather than stall.
+    if (!frame.end.isAvailable()) {
+        frame.used = 0;
+        m_lastGpuFrame = 0;
+        ++m_dropped;
+        return;
+    }
+
+    float gpu = 0.0f;
+    for (std::size_t idx = 0; idx < frame.used; ++idx) {
+        auto elapsed = toMilliseconds(std::chrono::nanoseconds(frame.samples[idx].query.result()));
+        m_scopes[frame.samples[idx].id].samples.push_back(elapsed);
+        gpu += elapsed;
+    }
+    frame.used = 0;
+
+    auto end = frame.end.result();
+    if (m_lastGpuFrame != 0) {
+        auto elapsed = std::chrono::nanoseconds(end - m_lastGpuFrame);
+        m_scopes[m_gpuFrame].samples.push_back(toMilliseconds(elapsed));
+    }
+    m_lastGpuFrame = end;
+
+    ++m_collected;
+    if (gpu > frame.work) { ++m_gpuBound; }
+}
+
+void Profiler::report()
+{
+    auto ratio = m_collected > 0 ? float(m_gpuBound) / float(m_collected) : 0.0f;
+    std::cerr <<"Profile at frame " <<m_frameCount <<": "
+              <<std::fixed <<std::setprecision(0) <<ratio * 100.0f <<"% GPU-bound";
+    if (m_dropped > 0) { std::cerr <<", " <<m_dropped <<" frames dropped"; }
+    std::cerr <<"\n    " <<std::left <<std::setw(16) <<"scope" <<std::right
+              <<std::setw(8) <<"mean" <<std::setw(8) <<"p50" <<std::setw(8) <<"p95"
+              <<std::setw(8) <<"p99" <<std::setw(8) <<"max" <<"  (ms)\n";
+    std::cerr <<std::setprecision(3);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto & scope : m_scopes) {
+        auto & samples = scope.samples;
+        if (samples.empty()) { continue; }
+        std::sort(samples.begin(), samples.end());
+
+        auto percentile = [&samples](float p) {
+            auto idx = std::min(samples.size() - 1, std::size_t(p * float(samples.size())));
+            return samples[idx];
+        };
+        float mean = 0.0f;
+        for (auto sample : samples) { mean += sample; }
+        mean /= float(samples.size());
+
+        std::cerr <<"    " <<std::left <<std::setw(16) <<scope.name <<std::right
+                  <<std::setw(8) <<mean <<std::setw(8) <<percentile(0.50f)
+                  <<std::setw(8) <<percentile(0.95f) <<std::setw(8) <<percentile(0.99f)
+                  <<std::setw(8) <<samples.back() <<'\n';
+        if (m_csv.is_open()) {
+            m_csv <<m_frameCount <<',' <<scope.name <<',' <<samples.size() <<','
+                  <<mean <<',' <<percentile(0.50f) <<',' <<percentile(0.95f) <<','
+                  <<percentile(0.99f) <<',' <<samples.back() <<',' <<ratio <<'\n';
+        }
+        samples.clear();
+    }
+    std::cerr.unsetf(std::ios::floatfield);
+    std::cerr <<std::setprecision(6) <<std::flush;
+    if (m_csv.is_open()) { m_csv.flush(); }
+
+    m_gpuBound = 0;
+    m_collected = 0;
+    m_dropped = 0;
+}
@@ -0,0 +1,232 @@
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <zlib.h>
+#include "Recorder.h"
+
+/// Check whether a string ends with given suffix
+static bool endsWith(const std::string & value, const char * suffix)
+{
+    const auto length = std::strlen(suffix);
+    return value.size() >= length && value.compare(value.size() - length, length, suffix) == 0;
+}
+
+/// Store a 32-bit value in big endian order, as PNG wants it
+static void putBigEndian(unsigned char * out, std::uint32_t value)
+{
+    out[0] = static_cast<unsigned char>(value >> 24);
+    out[1] = static_cast<unsigned char>(value >> 16);
+    out[2] = static_cast<unsigned char>(value >> 8);
+    out[3] = static_cast<unsigned char>(value);
+}
+
+/// Write a PNG chunk: length, type, data and checksum of type and data
+static void writeChunk(std::ofstream & file, const char * type,
+                       const unsigned char * data, std::size_t size)
+{
+    unsigned char header[8], footer[4];
+    putBigEndian(header, std::uint32_t(size));
+    std::memcpy(header + 4, type, 4);
+    auto crc = crc32(0, header + 4, 4);
+    if (size > 0) { crc = crc32(crc, data, uInt(size)); }   // a null buffer would reset it
+    putBigEndian(footer, std::uint32_t(crc));
+
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(data), std::streamsize(size));
+    file.write(reinterpret_cast<const char *>(footer), sizeof(footer));
+}
+
+/****************************************************************************/
+
+Recorder::Recorder(std::string path, GLsizei width, GLsizei height, unsigned queue)
+ : m_path(std::move(path)),
+   m_format(endsWith(m_path, ".png") ? format::Png : format::Raw),
+   m_readback(width, height),
+   m_capacity(queue)
+{
+    if (m_format == format::Raw) {
+        m_raw.open(m_path, std::ios::binary | std::ios::trunc);
+        if (!m_raw) { throw std::runtime_error("cannot open capture file " + m_path); }
+    }
+    m_thread = std::thread(&Recorder::threadMain, this);
+}
+
+Recorder::~Recorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) { m_thread.join(); }
+}
+
+Recorder::Counters Recorder::counters() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto counters = m_counters;
+    counters.stalls = m_readback.stalls();
+    return counters;
+}
+
+void Recorder::capture()
+{
+    const auto sink = [this](const unsigned char * pixels) { collect(pixels); };
+
+    // Collect whatever the GPU finished, only waiting when no buffer is left,
+    // on a read issued several frames ago, which rarely blocks
+    while (m_readback.retrieve(sink, false)) {}
+    if (m_readback.full()) { m_readback.retrieve(sink, true); }
+    m_readback.read();
+}
+
+void Recorder::finish()
+{
+    while (m_readback.retrieve([this](const unsigned char * pixels) { collect(pixels); }, true)) {}
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) { m_thread.join(); }
+    if (m_raw.is_open()) { m_raw.close(); }
+}
+
+void Recorder::collect(const unsigned char * pixels)
+{
+    const auto number = m_next++;
+
+    // Reuse a buffer the encoder is done with, rather than allocating every frame
+    std::vector<unsigned char> buffer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_counters.captured;
+        if (!m_free.empty()) {
+            buffer = std::move(m_free.back());
+            m_free.pop_back();
+        } else if (m_buffers < m_capacity && !m_failed) {
+            ++m_buffers;
+        } else {
+            ++m_counters.dropped;
+            return;
+        }
+    }
+
+    // Copy outside the lock, the encoder may carry on meanwhile
+    buffer.assign(pixels, pixels + m_readback.frameSize());
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back({ number, std::move(buffer) });
+    }
+    m_wake.notify_one();
+}
+
+/****************************************************************************/
+
+void Recorder::threadMain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_queue.empty()) { return; }                // stopping, and everything was written
+        auto frame = std::move(m_queue.front());
+        m_queue.pop_front();
+        const bool failed = m_failed;
+
+        lock.unlock();
+        const bool success = !failed && encode(frame);
+        lock.lock();
+
+        if (success) {
+            ++m_counters.written;
+        } else {
+            ++m_counters.dropped;
+            m_failed = true;
+        }
+        m_free.push_back(std::move(frame.pixels));
+    }
+}
+
+bool Recorder::encode(const Frame & frame)
+{
+    if (m_format == format::Png) { return writePng(frame); }
+
+    // OpenGL stores rows bottom to top, video wants them top to bottom
+    const auto rowSize = std::size_t(m_readback.width()) * gl::PixelReadback::pixelSize;
+    for (auto row = std::size_t(m_readback.height()); row > 0; --row) {
+        m_raw.write(reinterpret_cast<const char *>(frame.pixels.data() + (row - 1) * rowSize),
+                    std::streamsize(rowSize));
+    }
+    if (!m_raw) {
+        std::cerr <<"Capture failed, cannot write " <<m_path <<std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Recorder::writePng(const Frame & frame)
+{
+    static constexpr unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    const auto width = std::size_t(m_readback.width()), height = std::size_t(m_readback.height());
+    const auto rowSize = width * gl::PixelReadback::pixelSize;
+
+    // Every scanline starts with its filter type, 0 being none. Rows go top to bottom.
+    // The window has no alpha channel, so alpha is dropped rather than stored as noise.
+    m_scanlines.resize((width * 3 + 1) * height);
+    auto out = m_scanlines.data();
+    for (std::size_t row = 0; row < height; ++row) {
+        *out++ = 0;
+        auto in = frame.pixels.data() + (height - 1 - row) * rowSize;
+        for (std::size_t column = 0; column < width; ++column, in += gl::PixelReadback::pixelSize) {
+            *out++ = in[0];
+            *out++ = in[1];
+            *out++ = in[2];
+        }
+    }
+
+    // Fastest compression level, encoding must keep up with rendering
+    auto compressedSize = compressBound(m_scanlines.size());
+    m_compressed.resize(compressedSize);
+    if (compress2(m_compressed.data(), &compressedSize,
+                  m_scanlines.data(), m_scanlines.size(), Z_BEST_SPEED) != Z_OK) {
+        std::cerr <<"Capture failed, cannot compress frame " <<frame.number <<std::endl;
+        return false;
+    }
+
+    unsigned char header[13];
+    putBigEndian(header, std::uint32_t(width));
+    putBigEndian(header + 4, std::uint32_t(height));
+    header[8] = 8;                                      // 8 bits per channel
+    header[9] = 2;                                      // RGB
+    header[10] = header[11] = header[12] = 0;           // deflate, no filter set, no interlacing
+
+    const auto path = framePath(frame.number);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+    writeChunk(file, "IHDR", header, sizeof(header));
+    writeChunk(file, "IDAT", m_compressed.data(), compressedSize);
+    writeChunk(file, "IEND", nullptr, 0);
+    if (!file) {
+        std::cerr <<"Capture failed, cannot write " <<path <<std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string Recorder::framePath(unsigned long number) const
+{
+    auto end = m_path.find_last_of('#');
+    if (end == std::string::npos) { return m_path; }    // no pattern, overwrite the same file
+    auto begin = m_path.find_last_not_of('#', end);
+    begin = begin == std::string::npos ? 0 : begin + 1;
+
+    auto digits = std::to_string(number);
+    const auto width = end + 1 - begin;
+    if (digits.size() < width) { digits.insert(0, width - digits.size(), '0'); }
+    return m_path.substr(0, begin) + digits + m_path.substr(end + 1);
+}
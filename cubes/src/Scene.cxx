@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "Scene.h"
+#include "WorkerPool.h"
+
+// Portable SIMD types, the size of one SSE register on baseline x86-64, or one AVX
+// register when built with -march=native on a CPU that has it.
+typedef float floatv __attribute__((vector_size(Scene::lanes * sizeof(float))));
+typedef int intv __attribute__((vector_size(Scene::lanes * sizeof(int))));
+
+/// Broadcast a scalar value to all lanes
+static inline floatv splat(float value)
+{
+    floatv result;
+    for (std::size_t lane = 0; lane < Scene::lanes; ++lane) { result[lane] = value; }
+    return result;
+}
+
+/// Load lanes consecutive values, no alignment required
+static inline floatv load(const std::vector<float> & data, std::size_t idx)
+{
+    assert(idx + Scene::lanes <= data.size());
+    floatv result;
+    std::memcpy(&result, data.data() + idx, sizeof(result));
+    return result;
+}
+
+/** Compute sine and cosine of all lanes at once
+ *
+ * Reduces angle into [-pi/4, pi/4] around the nearest multiple of pi/2, then
+ * evaluates minimax polynomials from the Cephes library. Precise to a few ulps
+ * for angles up to several thousand radians, no branches.
+ */
+static inline void sincos(floatv angle, floatv & sine, floatv & cosine)
+{
+    const floatv zero = splat(0.0f), half = splat(0.5f), one = splat(1.0f);
+
+    // Quadrant, as the nearest integer of angle / (pi/2)
+    const floatv scaled = angle * splat(0.636619772367581f);
+    const intv quadrant = __builtin_convertvector(scaled + (scaled < zero ? -half : half), intv);
+    const floatv q = __builtin_convertvector(quadrant, floatv);
+
+    // Subtract q * pi/2 in three steps, to keep precision (Cody-Waite)
+    floatv x = angle - q * splat(1.5703125f);
+    x = x - q * splat(4.837512969970703125e-4f);
+    x = x - q * splat(7.54978995489188216e-8f);
+    const floatv x2 = x * x;
+
+    floatv s = splat(-1.9515295891e-4f);
+    s = s * x2 + splat(8.3321608736e-3f);
+    s = s * x2 + splat(-1.6666654611e-1f);
+    s = s * x2 * x + x;
+
+    floatv c = splat(2.443315711809948e-5f);
+    c = c * x2 + splat(-1.388731625493765e-3f);
+    c = c * x2 + splat(4.166664568298827e-2f);
+    c = c * x2 * x2 - half * x2 + one;
+
+    // Odd quadrants swap sine and cosine, then signs follow the unit circle
+    const intv swap = (quadrant & 1) != 0;
+    sine = swap ? c : s;
+    cosine = swap ? s : c;
+    sine = (quadrant & 2) != 0 ? -sine : sine;
+    cosine = ((quadrant + 1) & 2) != 0 ? -cosine : cosine;
+}
+
+/****************************************************************************/
+
+void Scene::reserve(std::size_t count)
+{
+    count = (count + lanes - 1) / lanes * lanes;
+    for (auto * array : { &m_x, &m_y, &m_z, &m_spin, &m_axisX, &m_axisY, &m_axisZ, &m_tumble }) {
+        array->reserve(count);
+    }
+}
+
+void Scene::add(const glm::vec3 & position, float spin, const glm::vec3 & axis, float tumble)
+{
+    if (m_count == m_x.size()) {
+        for (auto * array : { &m_x, &m_y, &m_z, &m_spin, &m_axisX, &m_axisY, &m_axisZ, &m_tumble }) {
+            array->resize(m_count + lanes, 0.0f);
+        }
+    }
+    m_x[m_count] = position.x;
+    m_y[m_count] = position.y;
+    m_z[m_count] = position.z;
+    m_spin[m_count] = spin;
+    m_axisX[m_count] = axis.x;
+    m_axisY[m_count] = axis.y;
+    m_axisZ[m_count] = axis.z;
+    m_tumble[m_count] = tumble;
+    ++m_count;
+}
+
+void Scene::computeTransforms(float time, glm::mat4 * out, WorkerPool & pool) const
+{
+    static_assert(grain % lanes == 0, "chunks must be made of whole batches");
+    pool.run(m_count, grain, [this, time, out](std::size_t begin, std::size_t end) {
+        computeRange(time, begin, end, out);
+    });
+}
+
+void Scene::computeRange(float time, std::size_t begin, std::size_t end, glm::mat4 * out) const
+{
+    assert(begin % lanes == 0);
+    const floatv t = splat(time), zero = splat(0.0f), one = splat(1.0f);
+
+    for (std::size_t base = begin; base < end; base += lanes) {
+        floatv sinSpin, cosSpin, sinTumble, cosTumble;
+        sincos(load(m_spin, base) * t, sinSpin, cosSpin);
+        sincos(load(m_tumble, base) * t, sinTumble, cosTumble);
+
+        // Tumbling rotation, from Rodrigues' formula - rows are first index
+        const floatv x = load(m_axisX, base), y = load(m_axisY, base), z = load(m_axisZ, base);
+        const floatv k = one - cosTumble;
+        const floatv r00 = k * x * x + cosTumble,  r01 = k * x * y - sinTumble * z,
+                     r02 = k * x * z + sinTumble * y;
+        const floatv r10 = k * x * y + sinTumble * z, r11 = k * y * y + cosTumble,
+                     r12 = k * y * z - sinTumble * x;
+        const floatv r20 = k * x * z - sinTumble * y, r21 = k * y * z + sinTumble * x,
+                     r22 = k * z * z + cosTumble;
+
+        // Spin around vertical axis only mixes first and last rows
+        const floatv columns[16] = {
+            cosSpin * r00 + sinSpin * r20, r10, cosSpin * r20 - sinSpin * r00, zero,
+            cosSpin * r01 + sinSpin * r21, r11, cosSpin * r21 - sinSpin * r01, zero,
+            cosSpin * r02 + sinSpin * r22, r12, cosSpin * r22 - sinSpin * r02, zero,
+            load(m_x, base), load(m_y, base), load(m_z, base), one
+        };
+
+        // Transpose into one column-major matrix per object, in order, so
+        // write-combined GPU memory only sees full sequential writes
+        const auto count = std::min(lanes, end - base);
+        for (std::size_t lane = 0; lane < count; ++lane) {
+            float * matrix = &out[base + lane][0][0];
+            for (std::size_t idx = 0; idx < 16; ++idx) { matrix[idx] = columns[idx][lane]; }
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include "WorkerPool.h"
+
+
+WorkerPool::WorkerPool(unsigned threads)
+{
+    if (threads == 0) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+    m_threads.reserve(threads - 1);
+    for (unsigned idx = 1; idx < threads; ++idx) {
+        m_threads.emplace_back(&WorkerPool::threadMain, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto & thread : m_threads) { thread.join(); }
+}
+
+void WorkerPool::run(std::size_t count, std::size_t grain, const task & fn)
+{
+    // Not worth waking anyone up for a single chunk
+    if (m_threads.empty() || count <= grain) {
+        if (count > 0) { fn(0, count); }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &fn;
+        m_count = count;
+        m_grain = grain;
+        m_next.store(0, std::memory_order_relaxed);
+        m_busy = unsigned(m_threads.size());
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    work();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_task = nullptr;
+}
+
+void WorkerPool::work()
+{
+    for (;;) {
+        auto begin = m_next.fetch_add(m_grain, std::memory_order_relaxed);
+        if (begin >= m_count) { break; }
+        (*m_task)(begin, std::min(begin + m_grain, m_count));
+    }
+}
+
+void WorkerPool::threadMain()
+{
+    unsigned generation = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [&] { return m_stop || m_generation != generation; });
+        if (m_stop) { return; }
+        generation = m_generation;
+
+        lock.unlock();
+        work();
+        lock.lock();
+
+        if (--m_busy == 0) { m_done.notify_one(); }
+    }
+}
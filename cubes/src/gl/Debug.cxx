@@ -0,0 +1,100 @@
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include "gl/Debug.h"
+
+using gl::DebugLog;
+
+
+DebugLog::DebugLog()
+{
+    if (!isSupported()) { return; }
+    glDebugMessageCallback(callback, this);
+    // Notifications are mostly chatter about buffer placement, leave them out
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION,
+                          0, nullptr, GL_FALSE);
+    glEnable(GL_DEBUG_OUTPUT);
+    m_active = true;
+}
+
+DebugLog::~DebugLog()
+{
+    if (!m_active) { return; }
+    glDisable(GL_DEBUG_OUTPUT);
+    glDebugMessageCallback(nullptr, nullptr);
+}
+
+bool DebugLog::isSupported()
+{
+    return hasVersion(4, 3) || hasExtension("GL_KHR_debug");
+}
+
+std::vector<DebugLog::Message> DebugLog::take()
+{
+    std::vector<Message> result;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    result.swap(m_messages);
+    return result;
+}
+
+unsigned DebugLog::takeDropped()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto result = m_dropped;
+    m_dropped = 0;
+    return result;
+}
+
+void GLAPIENTRY DebugLog::callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                   GLsizei length, const GLchar * message, const void * self)
+{
+    // Driver hands back the pointer given at registration, it is not really const
+    auto log = static_cast<DebugLog *>(const_cast<void *>(self));
+    std::lock_guard<std::mutex> lock(log->m_mutex);
+    if (log->m_messages.size() >= capacity) {
+        ++log->m_dropped;
+        return;
+    }
+    log->m_messages.push_back({
+        source, type, id, severity,
+        length < 0 ? std::string(message) : std::string(message, std::size_t(length))
+    });
+}
+
+/****************************************************************************/
+
+const char * DebugLog::sourceName(GLenum source)
+{
+    switch (source) {
+        case GL_DEBUG_SOURCE_API: return "api";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+        case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+        case GL_DEBUG_SOURCE_APPLICATION: return "application";
+        default: return "other";
+    }
+}
+
+const char * DebugLog::typeName(GLenum type)
+{
+    switch (type) {
+        case GL_DEBUG_TYPE_ERROR: return "error";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+        case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+        case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+        case GL_DEBUG_TYPE_MARKER: return "marker";
+        default: return "other";
+    }
+}
+
+const char * DebugLog::severityName(GLenum severity)
+{
+    switch (severity) {
+        case GL_DEBUG_SEVERITY_HIGH: return "high";
+        case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+        case GL_DEBUG_SEVERITY_LOW: return "low";
+        case GL_DEBUG_SEVERITY_NOTIFICATION: return "notification";
+        default: return "unknown";
+    }
+}
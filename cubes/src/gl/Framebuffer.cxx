@@ -0,0 +1,57 @@
+#include <cassert>
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include "gl/Framebuffer.h"
+
+using gl::Framebuffer;
+
+constexpr GLuint Framebuffer::invalid_id;
+
+
+Framebuffer::Framebuffer(GLsizei width, GLsizei height)
+ : m_width(width), m_height(height)
+{
+    glGenFramebuffers(1, &m_id);
+    if (m_id == invalid_id) { throw gl::error("glGenFramebuffers failed"); }
+    glGenRenderbuffers(1, &m_color);
+    glGenRenderbuffers(1, &m_depth);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, m_color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_id);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        clear();
+        throw gl::error("framebuffer is incomplete");
+    }
+}
+
+void Framebuffer::clear()
+{
+    if (m_id == invalid_id) { return; }
+    glDeleteFramebuffers(1, &m_id);
+    glDeleteRenderbuffers(1, &m_color);
+    glDeleteRenderbuffers(1, &m_depth);
+    m_id = invalid_id;
+    m_color = m_depth = 0;
+}
+
+void Framebuffer::bind() const
+{
+    assert(m_id != invalid_id);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_id);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void Framebuffer::unbind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, invalid_id);
+}
@@ -0,0 +1,213 @@
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "gl/Debug.h"
+#include "gl/ProgramCache.h"
+
+using gl::DebugLog;
+using gl::PendingProgram;
+using gl::Program;
+using gl::ProgramCache;
+
+/// Header of cache files
+struct FileHeader
+{
+    char            magic[4];                       ///< Always "GLPB"
+    std::uint32_t   format;                         ///< Driver binary format
+    std::uint64_t   key;                            ///< Cache key, guards against renamed files
+};
+static constexpr char fileMagic[4] = { 'G', 'L', 'P', 'B' };
+
+/// Strings identifying the driver, binaries are only valid if all of them match
+static constexpr GLenum driverStrings[] = {
+    GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION
+};
+
+/// Feed data into a 64-bit FNV-1a hash
+static std::uint64_t fnv1a(std::uint64_t hash, const void * data, std::size_t size)
+{
+    auto bytes = static_cast<const unsigned char *>(data);
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        hash = (hash ^ bytes[idx]) * 0x100000001b3u;
+    }
+    return hash;
+}
+
+/// Create a directory and its parents, returning false on failure
+static bool makeDirectories(const std::string & path)
+{
+    for (auto pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+        auto parent = path.substr(0, pos);
+        if (::mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST) { return false; }
+        if (pos == std::string::npos) { return true; }
+    }
+}
+
+/****************************************************************************/
+
+ProgramCache::ProgramCache(std::string directory)
+ : m_directory(std::move(directory))
+{
+    if (!isSupported() || !makeDirectories(m_directory)) { m_directory.clear(); }
+}
+
+bool ProgramCache::isSupported()
+{
+    if (!hasVersion(4, 1) && !hasExtension("GL_ARB_get_program_binary")) { return false; }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+Program ProgramCache::link(const std::vector<Source> & sources)
+{
+    return linkAsync(sources).take();
+}
+
+PendingProgram ProgramCache::linkAsync(const std::vector<Source> & sources)
+{
+    PendingProgram pending;
+    pending.m_poll = Shader::isParallelSupported();
+    if (enabled()) {
+        pending.m_key = key(sources);
+        pending.m_program = load(pending.m_key);
+        if (pending.valid()) {
+            ++m_counters.hits;
+            return pending;
+        }
+        pending.m_cache = this;
+    }
+    ++m_counters.misses;
+
+    // Checking status would wait for the driver, so leave it all to take()
+    std::vector<Shader *> pointers;
+    pending.m_shaders.reserve(sources.size());
+    for (const auto & source : sources) {
+        pending.m_shaders.push_back(Shader::compile(source.type, source.data, source.size));
+        pointers.push_back(&pending.m_shaders.back());
+    }
+    pending.m_program = Program::link(pointers, enabled());
+    return pending;
+}
+
+/****************************************************************************/
+
+std::uint64_t ProgramCache::key(const std::vector<Source> & sources)
+{
+    auto hash = std::uint64_t(0xcbf29ce484222325u);
+    for (auto name : driverStrings) {
+        auto value = reinterpret_cast<const char *>(glGetString(name));
+        if (value) { hash = fnv1a(hash, value, std::strlen(value) + 1); }
+    }
+    for (const auto & source : sources) {
+        auto type = static_cast<GLenum>(source.type);
+        hash = fnv1a(hash, &type, sizeof(type));
+        hash = fnv1a(hash, &source.size, sizeof(source.size));
+        hash = fnv1a(hash, source.data, source.size);
+    }
+    return hash;
+}
+
+std::string ProgramCache::path(std::uint64_t key) const
+{
+    char name[21];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return m_directory + '/' + name;
+}
+
+Program ProgramCache::load(std::uint64_t key) const
+{
+    std::ifstream file(path(key), std::ios::binary);
+    if (!file) { return {}; }
+
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))
+        || std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0
+        || header.key != key) { return {}; }
+    std::vector<char> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    // Driver rejects binaries it cannot use, eg: after an update, which fails linkage.
+    // It may raise an error too, eg: for an unknown format. That is expected here, so
+    // keep it out of debug output and clear it, falling back to compilation silently.
+    const bool debug = DebugLog::isSupported();
+    if (debug) {
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "load cached program");
+        glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+    }
+    auto program = Program::load(header.format, data.data(), data.size());
+    const bool rejected = program.hasError();
+    if (debug) { glPopDebugGroup(); }
+
+    if (rejected) {
+        while (glGetError() != GL_NO_ERROR) {}
+        return {};
+    }
+    return program;
+}
+
+void ProgramCache::save(std::uint64_t key, const Program & program) const
+{
+    GLenum format;
+    std::vector<unsigned char> data;
+    try {
+        data = program.binary(format);
+    } catch (gl::error &) {
+        return;                                     // Driver may refuse, eg: for lack of formats
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    header.format = format;
+    header.key = key;
+
+    // Write to a temporary file first, so concurrent runs never see partial files
+    const auto target = path(key);
+    const auto temporary = target + '.' + std::to_string(::getpid());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(data.data()), std::streamsize(data.size()));
+        if (!file) {
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+    std::rename(temporary.c_str(), target.c_str());
+}
+
+/****************************************************************************/
+
+bool PendingProgram::ready() const
+{
+    assert(valid());
+    return !m_poll || m_program.isCompleted();
+}
+
+Program PendingProgram::take()
+{
+    assert(valid());
+    auto shaders = std::move(m_shaders);
+    auto program = std::move(m_program);
+    auto cache = m_cache;
+    m_cache = nullptr;
+
+    // Linkage fails if any shader failed, whose log is more useful
+    if (program.hasError()) {
+        for (const auto & shader : shaders) {
+            if (shader.hasError()) { throw std::runtime_error(shader.error()); }
+        }
+        throw std::runtime_error(program.error());
+    }
+    if (cache) { cache->save(m_key, program); }
+    return program;
+}
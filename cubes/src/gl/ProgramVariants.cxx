@@ -0,0 +1,64 @@
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <sstream>
+#include "gl/ProgramVariants.h"
+
+/// Check whether a line holds given preprocessor directive, returning what follows it
+static bool matchDirective(const std::string & line, const char * directive, std::string & arguments)
+{
+    auto hash = line.find_first_not_of(" \t");
+    if (hash == std::string::npos || line[hash] != '#') { return false; }
+
+    std::istringstream stream(line.substr(hash + 1)), expected(directive);
+    std::string word, part;
+    while (expected >> part) {
+        if (!(stream >> word) || word != part) { return false; }
+    }
+    std::getline(stream, arguments);
+    return true;
+}
+
+std::string gl::specializeShader(const void * source, std::size_t size,
+                                 const std::vector<const char *> & defines)
+{
+    const std::string code(static_cast<const char *>(source), size);
+
+    // Everything up to and including the #version line stays in place
+    std::size_t begin = 0, line = 1;
+    std::string arguments;
+    for (;;) {
+        auto end = code.find('\n', begin);
+        if (end == std::string::npos) { throw gl::error("shader source has no #version line"); }
+        if (matchDirective(code.substr(begin, end - begin), "version", arguments)) {
+            begin = end + 1;
+            break;
+        }
+        begin = end + 1;
+        ++line;
+    }
+
+    std::string result = code.substr(0, begin);
+    for (const auto & name : defines) {
+        result += "#define ";
+        result += name;
+        result += " 1\n";
+    }
+    result += "#line " + std::to_string(line + 1) + '\n';
+    result.append(code, begin, std::string::npos);
+    return result;
+}
+
+std::vector<std::string> gl::declaredFeatures(const void * source, std::size_t size)
+{
+    std::istringstream code(std::string(static_cast<const char *>(source), size));
+    std::vector<std::string> result;
+    std::string line, arguments;
+    while (std::getline(code, line)) {
+        if (!matchDirective(line, "pragma features", arguments)) { continue; }
+        std::istringstream names(arguments);
+        std::string name;
+        while (names >> name) { result.push_back(name); }
+    }
+    return result;
+}
@@ -0,0 +1,47 @@
+#include <cassert>
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include "gl/Query.h"
+
+using gl::Query;
+
+
+Query::Query()
+{
+    glGenQueries(1, &m_id);
+    if (m_id == invalid_id) { throw gl::error("glGenQueries failed"); }
+}
+
+void Query::begin(target tgt)
+{
+    assert(m_id != invalid_id);
+    glBeginQuery(static_cast<GLenum>(tgt), m_id);
+}
+
+void Query::end(target tgt)
+{
+    glEndQuery(static_cast<GLenum>(tgt));
+}
+
+void Query::timestamp()
+{
+    assert(m_id != invalid_id);
+    glQueryCounter(m_id, GL_TIMESTAMP);
+}
+
+bool Query::isAvailable() const
+{
+    assert(m_id != invalid_id);
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(m_id, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available == GL_TRUE;
+}
+
+GLuint64 Query::result() const
+{
+    assert(m_id != invalid_id);
+    GLuint64 value = 0;
+    glGetQueryObjectui64v(m_id, GL_QUERY_RESULT, &value);
+    return value;
+}
@@ -2,6 +2,7 @@
 #define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
 #include <GL/glext.h>
+#include <SDL_video.h>
 
 #include "gl/Shader.h"
 
@@ -10,6 +11,23 @@
 using gl::Shader;
 using gl::Program;
 
+namespace {
+
+/// Set by Shader::setCompilerThreads(). Only libGL exports this entry point, not
+/// libOpenGL that we link against, so it is always resolved at runtime.
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads = nullptr;
+
+/// Name of the entry point of whichever extension current context advertises, if any.
+/// ARB and KHR versions share signature and enum values.
+const char * compilerThreadsFunction()
+{
+    if (gl::hasExtension("GL_KHR_parallel_shader_compile")) { return "glMaxShaderCompilerThreadsKHR"; }
+    if (gl::hasExtension("GL_ARB_parallel_shader_compile")) { return "glMaxShaderCompilerThreadsARB"; }
+    return nullptr;
+}
+
+}
+
 
 bool Shader::hasError() const
 {
@@ -32,6 +50,31 @@ std::string Shader::error() const
     return buffer;
 }
 
+bool Shader::isCompleted() const
+{
+    assert(m_id != invalid_id);
+    GLint status;
+    glGetShaderiv(m_id, GL_COMPLETION_STATUS_KHR, &status);
+    return status == GL_TRUE;
+}
+
+bool Shader::isParallelSupported()
+{
+    return compilerThreadsFunction() != nullptr;
+}
+
+void Shader::setCompilerThreads(GLuint count)
+{
+    if (!maxShaderCompilerThreads) {
+        const char * name = compilerThreadsFunction();
+        if (!name) { throw gl::error("parallel shader compilation is not supported"); }
+        maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(
+            SDL_GL_GetProcAddress(name));
+        if (!maxShaderCompilerThreads) { throw gl::error(std::string(name) + " not found"); }
+    }
+    maxShaderCompilerThreads(count);
+}
+
 Shader Shader::compile(type t, const void * ptr, std::size_t size)
 {
     auto id = glCreateShader(static_cast<GLenum>(t));
@@ -73,14 +116,46 @@ std::string Program::error() const
     return buffer;
 }
 
-Program Program::link(std::vector<Shader *> shaders)
+bool Program::isCompleted() const
+{
+    assert(m_id != invalid_id);
+    GLint status;
+    glGetProgramiv(m_id, GL_COMPLETION_STATUS_KHR, &status);
+    return status == GL_TRUE;
+}
+
+std::vector<unsigned char> Program::binary(GLenum & format) const
+{
+    assert(m_id != invalid_id);
+    GLint size = 0;
+    glGetProgramiv(m_id, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0) { throw gl::error("program has no binary form"); }
+
+    auto buffer = std::vector<unsigned char>(std::size_t(size));
+    glGetProgramBinary(m_id, size, nullptr, &format, buffer.data());
+    return buffer;
+}
+
+Program Program::link(std::vector<Shader *> shaders, bool retrievable)
 {
     auto id = glCreateProgram();
     if (id == invalid_id) { throw gl::error("glCreateProgram failed"); }
 
+    if (retrievable) { glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); }
     for (auto & shader : shaders) { glAttachShader(id, shader->id()); }
     glLinkProgram(id);
     for (auto & shader : shaders) { glDetachShader(id, shader->id()); }
+    StateCache::current().forgetProgram(id);
+
+    return Program(id);
+}
+
+Program Program::load(GLenum format, const void * data, std::size_t size)
+{
+    auto id = glCreateProgram();
+    if (id == invalid_id) { throw gl::error("glCreateProgram failed"); }
 
+    glProgramBinary(id, format, data, GLsizei(size));
+    StateCache::current().forgetProgram(id);
     return Program(id);
 }
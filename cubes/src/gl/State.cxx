@@ -0,0 +1,144 @@
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <algorithm>
+#include <cstring>
+#include "gl/State.h"
+
+using gl::StateCache;
+
+constexpr GLuint StateCache::unknown;
+
+/// Cache of the context current on this thread
+static thread_local StateCache * s_current = nullptr;
+
+
+StateCache::StateCache()
+{
+    makeCurrent();
+}
+
+StateCache::~StateCache()
+{
+    if (s_current == this) { s_current = nullptr; }
+}
+
+StateCache & StateCache::current()
+{
+    // Simple programs with a single context need not bother creating a cache
+    if (s_current == nullptr) {
+        static thread_local StateCache fallback;
+        s_current = &fallback;
+    }
+    return *s_current;
+}
+
+void StateCache::makeCurrent() noexcept
+{
+    s_current = this;
+}
+
+void StateCache::invalidate()
+{
+    m_capabilities.clear();
+    m_buffers.clear();
+    m_indexedBuffers.clear();
+    m_program = unknown;
+    m_vertexArray = unknown;
+    m_blendSrc = m_blendDst = m_blendEquation = unknown;
+    m_depthFunc = unknown;
+    m_depthMask = unknown;
+    m_uniforms.clear();
+}
+
+/****************************************************************************/
+
+void StateCache::forgetProgram(GLuint id)
+{
+    // Program stays active until another one is used, but its uniforms go away,
+    // and its identifier may be reused by a new program afterwards. Linking resets
+    // uniforms as well, and may lay them out differently.
+    for (auto it = m_uniforms.begin(); it != m_uniforms.end(); ) {
+        if (it->first >> 32 == id) { it = m_uniforms.erase(it); } else { ++it; }
+    }
+}
+
+void StateCache::forgetVertexArray(GLuint id)
+{
+    if (m_vertexArray == id) {
+        m_vertexArray = 0;
+        lookup(m_buffers, GL_ELEMENT_ARRAY_BUFFER, unknown) = 0;
+    }
+}
+
+void StateCache::forgetBuffer(GLuint id)
+{
+    for (auto & entry : m_buffers) {
+        if (entry.second == id) { entry.second = 0; }
+    }
+    for (auto & entry : m_indexedBuffers) {
+        if (entry.id == id) { entry = { entry.target, entry.index, 0, 0, 0 }; }
+    }
+}
+
+/****************************************************************************/
+
+void StateCache::bindBufferRange(GLenum target, GLuint index, GLuint id,
+                                 GLintptr offset, GLsizeiptr size)
+{
+    auto it = std::find_if(m_indexedBuffers.begin(), m_indexedBuffers.end(),
+                           [=](const IndexedBinding & entry) {
+                               return entry.target == target && entry.index == index;
+                           });
+    if (it == m_indexedBuffers.end()) {
+        it = m_indexedBuffers.insert(it, { target, index, unknown, 0, 0 });
+    }
+    if (elide(it->id == id && it->offset == offset && it->size == size)) { return; }
+
+    // Only an actual call changes the generic binding, an elided one leaves it alone
+    *it = { target, index, id, offset, size };
+    lookup(m_buffers, target, unknown) = id;
+    glBindBufferRange(target, index, id, offset, size);
+}
+
+/****************************************************************************/
+
+bool StateCache::uniformChanged(GLint location, const void * data, std::size_t size)
+{
+    // Location -1 is silently ignored by OpenGL, do the same
+    if (location < 0) {
+        elide(true);
+        return false;
+    }
+
+    auto key = std::uint64_t(m_program) << 32 | std::uint32_t(location);
+    auto & value = m_uniforms[key];
+    if (elide(value.size() == size && std::memcmp(value.data(), data, size) == 0)) {
+        return false;
+    }
+    auto bytes = static_cast<const unsigned char *>(data);
+    value.assign(bytes, bytes + size);
+    return true;
+}
+
+void StateCache::uniform1i(GLint location, GLint value)
+{
+    if (uniformChanged(location, &value, sizeof(value))) { glUniform1i(location, value); }
+}
+
+void StateCache::uniform1f(GLint location, GLfloat value)
+{
+    if (uniformChanged(location, &value, sizeof(value))) { glUniform1f(location, value); }
+}
+
+void StateCache::uniform4fv(GLint location, const GLfloat * value)
+{
+    if (uniformChanged(location, value, 4 * sizeof(GLfloat))) { glUniform4fv(location, 1, value); }
+}
+
+void StateCache::uniformMatrix4fv(GLint location, const GLfloat * value)
+{
+    if (uniformChanged(location, value, 16 * sizeof(GLfloat))) {
+        glUniformMatrix4fv(location, 1, GL_FALSE, value);
+    }
+}
@@ -0,0 +1,35 @@
+#include <cassert>
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include "gl/Sync.h"
+
+using gl::Fence;
+
+
+bool Fence::isSignaled() const
+{
+    assert(m_id != nullptr);
+    GLint status = GL_UNSIGNALED;
+    glGetSynciv(m_id, GL_SYNC_STATUS, sizeof(status), nullptr, &status);
+    return status == GL_SIGNALED;
+}
+
+bool Fence::wait(std::chrono::nanoseconds timeout) const
+{
+    assert(m_id != nullptr);
+    // Flush on first wait, otherwise the fence may never reach the GPU
+    switch (glClientWaitSync(m_id, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(timeout.count()))) {
+        case GL_ALREADY_SIGNALED:
+        case GL_CONDITION_SATISFIED:    return true;
+        case GL_TIMEOUT_EXPIRED:        return false;
+        default:                        throw gl::error("glClientWaitSync failed");
+    }
+}
+
+Fence Fence::insert()
+{
+    auto id = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (id == nullptr) { throw gl::error("glFenceSync failed"); }
+    return Fence(id);
+}
@@ -6,10 +6,14 @@
 using gl::VertexArray;
 
 constexpr GLuint VertexArray::invalid_id;
-GLuint VertexArray::s_bound = VertexArray::invalid_id;
 
 VertexArray::VertexArray()
 {
     glGenVertexArrays(1, &m_id);
     if (m_id == invalid_id) { throw error("glGenVertexArrays failed"); }
 }
+
+bool VertexArray::isIndirectSupported()
+{
+    return hasVersion(4, 3) || hasExtension("GL_ARB_multi_draw_indirect");
+}
@@ -1,5 +1,7 @@
 #define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
+#include <GL/glext.h>
+#include <cstring>
 #include "gl/common.h"
 
 using gl::error;
@@ -18,3 +20,22 @@ const char * error::messageForGlError(GLenum code)
         default: return "Unknown error";
     }
 }
+
+bool gl::hasVersion(int major, int minor)
+{
+    GLint actualMajor = 0, actualMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &actualMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &actualMinor);
+    return actualMajor > major || (actualMajor == major && actualMinor >= minor);
+}
+
+bool gl::hasExtension(const char * name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint idx = 0; idx < count; ++idx) {
+        auto extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, GLuint(idx)));
+        if (extension && std::strcmp(extension, name) == 0) { return true; }
+    }
+    return false;
+}
@@ -1,7 +1,10 @@
 #define GL_GLEXT_PROTOTYPES
 #include <csignal>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <getopt.h>
+#include <unistd.h>
 #include <SDL.h>
 #include "Application.h"
 
@@ -13,23 +16,146 @@ static std::unique_ptr<Application> app;
 /// Signal handler that tells `app` to quit as soon as possible
 static void quit_handler(int) { app->quit(); }
 
+/// Get default directory for caching program binaries, following XDG conventions
+static std::string default_shader_cache()
+{
+    if (auto base = std::getenv("XDG_CACHE_HOME")) {
+        if (*base != '\0') { return std::string(base) + "/cubes"; }
+    }
+    if (auto home = std::getenv("HOME")) { return std::string(home) + "/.cache/cubes"; }
+    return {};
+}
+
+/// Get default mesh file: the one next to the executable when running from the build
+/// directory, or else the installed one
+static std::string default_mesh_path()
+{
+    static const char meshFile[] = "assets/cube.mesh";
+    if (auto base = SDL_GetBasePath()) {
+        auto path = std::string(base) + meshFile;
+        SDL_free(base);
+        if (access(path.c_str(), R_OK) == 0) { return path; }
+    }
+    return std::string(CUBES_DATA_DIR "/") + meshFile;
+}
 
-int main(int, char *[])
+/// Parse command line into application options, return false on error
+static bool parse_options(int argc, char * argv[], Application::Options & options)
 {
+    static const struct option longOptions[] = {
+        { "bench", required_argument, nullptr, 'b' },
+        { "capture", required_argument, nullptr, 'r' },
+        { "tick-rate", required_argument, nullptr, 'u' },
+        { "vsync", required_argument, nullptr, 'v' },
+        { "max-fps", required_argument, nullptr, 'F' },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:cdfhlm:n:t:p:o:r:s:u:v:F:", longOptions, nullptr)) != -1) {
+        switch (opt) {
+        case 'n':
+            options.instances = unsigned(std::strtoul(optarg, nullptr, 10));
+            if (options.instances == 0) {
+                std::cerr <<"Cube count must be at least 1" <<std::endl;
+                return false;
+            }
+            break;
+        case 'b':
+            options.benchFrames = unsigned(std::strtoul(optarg, nullptr, 10));
+            if (options.benchFrames == 0) {
+                std::cerr <<"Benchmark must run at least 1 frame" <<std::endl;
+                return false;
+            }
+            break;
+        case 't':
+            options.threads = unsigned(std::strtoul(optarg, nullptr, 10));
+            break;
+        case 'u':
+            options.tickRate = unsigned(std::strtoul(optarg, nullptr, 10));
+            if (options.tickRate == 0) {
+                std::cerr <<"Tick rate must be at least 1" <<std::endl;
+                return false;
+            }
+            break;
+        case 'p':
+            options.profilePeriod = unsigned(std::strtoul(optarg, nullptr, 10));
+            break;
+        case 'o':
+            options.profileFile = optarg;
+            if (options.profilePeriod == 0) { options.profilePeriod = 300; }
+            break;
+        case 'r':
+            options.capturePath = optarg;
+            break;
+        case 'v':
+            if (std::strcmp(optarg, "off") == 0) {
+                options.vsync = FramePacer::sync::Off;
+            } else if (std::strcmp(optarg, "on") == 0) {
+                options.vsync = FramePacer::sync::On;
+            } else if (std::strcmp(optarg, "adaptive") == 0) {
+                options.vsync = FramePacer::sync::Adaptive;
+            } else {
+                std::cerr <<"V-sync must be off, on or adaptive" <<std::endl;
+                return false;
+            }
+            break;
+        case 'F':
+            options.maxFrameRate = unsigned(std::strtoul(optarg, nullptr, 10));
+            break;
+        case 'm':
+            options.meshPath = optarg;
+            break;
+        case 's':
+            options.shaderCache = optarg;
+            break;
+        case 'c':
+            options.culling = true;
+            break;
+        case 'd':
+            options.debug = true;
+            break;
+        case 'f':
+            options.fog = true;
+            break;
+        case 'l':
+            options.lighting = true;
+            break;
+        case 'h':
+        default:
+            std::cerr <<"Usage: " <<argv[0] <<" [--bench frames] [-c] [-d] [-f] [-l] [-m mesh] [-n cubes] [-t threads] [-u tickrate] [-v off|on|adaptive] [-F maxfps] [-p frames] [-o profile.csv] [-r capture] [-s cachedir]" <<std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+int main(int argc, char * argv[])
+{
+    Application::Options options;
+    options.shaderCache = default_shader_cache();
+    options.meshPath = default_mesh_path();
+    if (!parse_options(argc, argv, options)) { return 1; }
+
     SDL_version version;
     SDL_GetVersion(&version);
     std::cerr <<"Running on SDL " <<int(version.major) <<'.'
                                   <<int(version.minor) <<'.'
                                   <<int(version.patch) <<std::endl;
 
+    // Benchmarks run on machines without a display, SDL then renders through EGL surfaceless
+    if (options.benchFrames > 0 && !std::getenv("DISPLAY") && !std::getenv("WAYLAND_DISPLAY")) {
+        setenv("SDL_VIDEODRIVER", "offscreen", 0);         // unless user chose a driver
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0) {
         std::cerr <<SDL_GetError() <<std::endl;
     }
     std::atexit(SDL_Quit);
-    SDL_GL_SetSwapInterval(1);
 
     // Initialize the application
-    app = std::unique_ptr<Application>(new Application("cubes"));
+    app = std::unique_ptr<Application>(new Application("cubes", options));
 
     // Intercept signals to be able to quit gracefully
     std::signal(SIGINT, quit_handler);
@@ -0,0 +1,166 @@
+// Tests for gl::StreamBuffer, run on a hidden window of whatever driver is available.
+// Mesa's llvmpipe is enough: ctest forces it through LIBGL_ALWAYS_SOFTWARE.
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <SDL.h>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "gl/State.h"
+#include "gl/StreamBuffer.h"
+
+/****************************************************************************/
+
+/// Exit code telling ctest the test was skipped, for lack of a suitable context
+static constexpr int skipped = 77;
+
+static unsigned failures = 0;
+
+/// Report a failed check without aborting, so one run shows every failure
+#define EXPECT(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr <<__FILE__ <<":" <<__LINE__ <<": expected " #condition <<std::endl; \
+            ++failures; \
+        } \
+    } while (false)
+
+/// Read back a range of a buffer, as the GPU sees it
+template <gl::target Target>
+static std::vector<unsigned char> readBack(gl::Buffer<Target> & buffer, std::size_t offset, std::size_t size)
+{
+    std::vector<unsigned char> data(size);
+    buffer.bind();
+    glGetBufferSubData(static_cast<GLenum>(Target), GLintptr(offset), GLsizeiptr(size), data.data());
+    return data;
+}
+
+/****************************************************************************/
+
+/// Regions are padded to the alignment, and allocations never cross them
+static void testAllocation()
+{
+    gl::VertexStreamBuffer stream(100, 3, 64);
+    EXPECT(stream.valid());
+    EXPECT(stream.frameSize() == 128);
+    EXPECT(stream.alignment() == 64);
+
+    for (unsigned frame = 0; frame < 6; ++frame) {
+        stream.beginFrame();
+        EXPECT(stream.frameOffset() == (frame % 3) * 128);
+
+        auto first = stream.allocate(10, 4);
+        auto second = stream.allocate(8, 64);
+        EXPECT(first.offset == stream.frameOffset());
+        EXPECT(second.offset == stream.frameOffset() + 64);
+        EXPECT(second.as<unsigned char>() - first.as<unsigned char>() == 64);
+
+        bool exhausted = false;
+        try { stream.allocate(64, 4); } catch (gl::error &) { exhausted = true; }
+        EXPECT(exhausted);
+        stream.endFrame();
+    }
+}
+
+/// Data written through the mapping reaches the buffer without any flush or copy,
+/// and each frame only touches its own region
+static void testCoherency()
+{
+    constexpr std::size_t size = 256;
+    gl::VertexStreamBuffer stream(size);
+
+    for (unsigned frame = 0; frame < 3; ++frame) {
+        stream.beginFrame();
+        auto chunk = stream.allocate(size);
+        std::memset(chunk.data, int('a' + frame), size);
+        stream.endFrame();
+    }
+    for (unsigned frame = 0; frame < 3; ++frame) {
+        auto data = readBack(stream.buffer(), frame * size, size);
+        EXPECT(data == std::vector<unsigned char>(size, static_cast<unsigned char>('a' + frame)));
+    }
+}
+
+/// Going around the ring waits on fences, which an idle GPU has already signaled
+static void testFences()
+{
+    gl::VertexStreamBuffer stream(64);
+    for (unsigned frame = 0; frame < 10; ++frame) {
+        stream.beginFrame();
+        std::memset(stream.allocate(64).data, int(frame), 64);
+        stream.endFrame();
+        glFinish();
+    }
+    EXPECT(stream.stalls() == 0);
+}
+
+/// Moving hands the mapping over, leaving the source invalid
+static void testMove()
+{
+    gl::VertexStreamBuffer source(64);
+    const auto id = source.buffer().id();
+
+    gl::VertexStreamBuffer target(std::move(source));
+    EXPECT(!source.valid());
+    EXPECT(target.valid());
+    EXPECT(target.buffer().id() == id);
+
+    gl::VertexStreamBuffer assigned;
+    assigned = std::move(target);
+    EXPECT(!target.valid());
+    EXPECT(assigned.valid());
+    EXPECT(assigned.frameSize() == 64);
+
+    assigned.beginFrame();
+    auto chunk = assigned.allocate(64);
+    std::memset(chunk.data, 0x5a, 64);
+    assigned.endFrame();
+    EXPECT(readBack(assigned.buffer(), chunk.offset, 64) == std::vector<unsigned char>(64, 0x5a));
+}
+
+/****************************************************************************/
+
+int main()
+{
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        std::cerr <<"Skipping, cannot initialize SDL: " <<SDL_GetError() <<std::endl;
+        return skipped;
+    }
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    auto window = SDL_CreateWindow("StreamBuffer tests", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                   16, 16, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    auto context = window ? SDL_GL_CreateContext(window) : nullptr;
+    if (!context) {
+        std::cerr <<"Skipping, cannot create OpenGL context: " <<SDL_GetError() <<std::endl;
+        SDL_Quit();
+        return skipped;
+    }
+
+    int result = skipped;
+    {
+        gl::StateCache state;
+        if (gl::VertexStreamBuffer::isSupported()) {
+            testAllocation();
+            testCoherency();
+            testFences();
+            testMove();
+            if (glGetError() != GL_NO_ERROR) {
+                std::cerr <<"OpenGL error raised during tests" <<std::endl;
+                ++failures;
+            }
+            std::cerr <<(failures == 0 ? "All tests passed" : "Some tests failed") <<std::endl;
+            result = failures == 0 ? 0 : 1;
+        } else {
+            std::cerr <<"Skipping, context lacks ARB_buffer_storage" <<std::endl;
+        }
+    }
+
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return result;
+}
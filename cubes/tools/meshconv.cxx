@@ -0,0 +1,417 @@
+/** Mesh converter, run at build time
+ *
+ * Reads a triangle mesh from a Wavefront OBJ or an ASCII PLY file, indexes
+ * and optimizes it through Mesh, and writes it out in the binary format of
+ * MeshFile.h, ready for Mesh::load() to hand over to the GPU.
+ *
+ * Usage: meshconv <input.obj|input.ply> <output.mesh>
+ *
+ * Polygons are split into triangle fans. Vertices lacking a normal get the
+ * normal of their triangle, giving flat faces. Colors are read from PLY
+ * red, green, blue and alpha properties, or from the common OBJ extension
+ * adding them after vertex coordinates. Vertices lacking one are white.
+ * Positions are quantized to 16 bits over the mesh bounding box.
+ */
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "gl/Vertex.h"
+#include "Mesh.h"
+#include "MeshFile.h"
+
+using vec3 = std::array<float, 3>;
+using rgba = std::array<std::uint8_t, 4>;
+
+/// A triangle corner, as read from source file
+struct Corner
+{
+    vec3        position;                           ///< Model coordinates
+    vec3        normal;                             ///< Unit normal, if hasNormal is set
+    bool        hasNormal;                          ///< Whether file gave a normal
+    rgba        color;                              ///< RGBA8 color
+};
+
+static constexpr rgba white = {{ 255, 255, 255, 255 }};
+
+/// Mapping of positions to signed normalized 16-bit values, see MeshVertex
+struct Quantization
+{
+    vec3        scale;                              ///< Half size of bounding box
+    vec3        bias;                               ///< Center of bounding box
+
+    /// Quantize a coordinate along given axis
+    std::int16_t encode(float value, std::size_t axis) const
+    {
+        if (scale[axis] == 0.0f) { return 0; }      // Flat along that axis
+        const auto normalized = std::clamp((value - bias[axis]) / scale[axis], -1.0f, 1.0f);
+        return std::int16_t(std::lround(normalized * 32767.0f));
+    }
+    /// Get back a coordinate along given axis, as vertex fetch does
+    float decode(std::int16_t value, std::size_t axis) const
+    {
+        return float(value) / 32767.0f * scale[axis] + bias[axis];
+    }
+};
+
+/// Error in source file, giving its location
+static std::runtime_error parseError(const std::string & path, unsigned line, const std::string & what)
+{
+    return std::runtime_error(path + ':' + std::to_string(line) + ": " + what);
+}
+
+/// Check whether a string ends with given suffix
+static bool endsWith(const std::string & value, const char * suffix)
+{
+    const auto length = std::strlen(suffix);
+    return value.size() >= length && value.compare(value.size() - length, length, suffix) == 0;
+}
+
+/// Convert a color component in [0, 1] to 8 bits
+static std::uint8_t toByte(float value)
+{
+    return std::uint8_t(std::lround(std::fmin(std::fmax(value, 0.0f), 1.0f) * 255.0f));
+}
+
+/****************************************************************************/
+
+/// Read polygons from a Wavefront OBJ file, as triangle corners
+static std::vector<Corner> readObj(const std::string & path)
+{
+    std::ifstream file(path);
+    if (!file) { throw std::runtime_error(path + ": cannot open file"); }
+
+    std::vector<vec3> positions, normals;
+    std::vector<rgba> colors;
+    std::vector<Corner> corners, polygon;
+    std::string text, keyword;
+    for (unsigned line = 1; std::getline(file, text); ++line) {
+        std::istringstream stream(text);
+        if (!(stream >> keyword) || keyword[0] == '#') { continue; }
+
+        if (keyword == "v") {
+            vec3 position, color;
+            if (!(stream >> position[0] >> position[1] >> position[2])) {
+                throw parseError(path, line, "invalid vertex");
+            }
+            positions.push_back(position);
+            colors.push_back(stream >> color[0] >> color[1] >> color[2]
+                             ? rgba{{ toByte(color[0]), toByte(color[1]), toByte(color[2]), 255 }}
+                             : white);
+        } else if (keyword == "vn") {
+            vec3 normal;
+            if (!(stream >> normal[0] >> normal[1] >> normal[2])) {
+                throw parseError(path, line, "invalid normal");
+            }
+            normals.push_back(normal);
+        } else if (keyword == "f") {
+            // Elements are v, v/vt, v//vn or v/vt/vn, counting from 1, or from the end if negative
+            const auto resolve = [&](long index, std::size_t count) {
+                const auto resolved = index < 0 ? long(count) + index : index - 1;
+                if (index == 0 || resolved < 0 || resolved >= long(count)) {
+                    throw parseError(path, line, "index out of range");
+                }
+                return std::size_t(resolved);
+            };
+            polygon.clear();
+            std::string element;
+            while (stream >> element) {
+                Corner corner{};
+                auto position = resolve(std::stol(element), positions.size());
+                corner.position = positions[position];
+                corner.color = colors[position];
+                auto slash = element.find('/');
+                if (slash != std::string::npos) {
+                    slash = element.find('/', slash + 1);
+                    if (slash != std::string::npos && slash + 1 < element.size()) {
+                        corner.normal = normals[resolve(std::stol(element.substr(slash + 1)), normals.size())];
+                        corner.hasNormal = true;
+                    }
+                }
+                polygon.push_back(corner);
+            }
+            if (polygon.size() < 3) { throw parseError(path, line, "face has less than 3 vertices"); }
+            for (std::size_t idx = 2; idx < polygon.size(); ++idx) {
+                corners.insert(corners.end(), { polygon[0], polygon[idx - 1], polygon[idx] });
+            }
+        }
+        // Anything else, such as texture coordinates, groups and materials, is ignored
+    }
+    return corners;
+}
+
+/****************************************************************************/
+
+/// Read polygons from an ASCII PLY file, as triangle corners
+static std::vector<Corner> readPly(const std::string & path)
+{
+    std::ifstream file(path);
+    if (!file) { throw std::runtime_error(path + ": cannot open file"); }
+
+    /// A property of an element, as declared in header
+    struct Property
+    {
+        std::string     name;                       ///< Property name, eg: x or red
+        bool            list;                       ///< Whether this is a list property
+        bool            integer;                    ///< Whether values are integers
+    };
+    /// An element, as declared in header
+    struct Element
+    {
+        std::string     name;                       ///< Element name, eg: vertex or face
+        std::size_t     count;                      ///< Number of elements in file
+        std::vector<Property> properties;           ///< Values of each element, in order
+    };
+
+    std::string text, keyword;
+    unsigned line = 1;
+    if (!std::getline(file, text) || text.compare(0, 3, "ply") != 0) {
+        throw parseError(path, line, "not a PLY file");
+    }
+    std::vector<Element> elements;
+    while (++line, std::getline(file, text)) {
+        std::istringstream stream(text);
+        if (!(stream >> keyword) || keyword == "comment" || keyword == "obj_info") { continue; }
+        if (keyword == "end_header") { break; }
+        if (keyword == "format") {
+            std::string format;
+            if (!(stream >> format) || format != "ascii") {
+                throw parseError(path, line, "only ASCII PLY files are supported");
+            }
+        } else if (keyword == "element") {
+            Element element;
+            if (!(stream >> element.name >> element.count)) { throw parseError(path, line, "invalid element"); }
+            elements.push_back(element);
+        } else if (keyword == "property") {
+            if (elements.empty()) { throw parseError(path, line, "property outside of element"); }
+            Property property{};
+            std::string type;
+            if (!(stream >> type)) { throw parseError(path, line, "invalid property"); }
+            if (type == "list") {
+                property.list = true;
+                std::string countType;
+                stream >> countType >> type;
+            }
+            property.integer = type != "float" && type != "float32" && type != "double" && type != "float64";
+            if (!(stream >> property.name)) { throw parseError(path, line, "invalid property"); }
+            elements.back().properties.push_back(property);
+        }
+    }
+
+    std::vector<Corner> vertices, corners;
+    for (const auto & element : elements) {
+        for (std::size_t item = 0; item < element.count; ++item) {
+            if (!(++line, std::getline(file, text))) { throw parseError(path, line, "unexpected end of file"); }
+            std::istringstream stream(text);
+
+            Corner vertex{};
+            vertex.color = white;
+            std::vector<long> indices;
+            for (const auto & property : element.properties) {
+                if (property.list) {
+                    std::size_t count = 0;
+                    stream >> count;
+                    for (std::size_t idx = 0; idx < count; ++idx) {
+                        long index = 0;
+                        stream >> index;
+                        indices.push_back(index);
+                    }
+                    continue;
+                }
+                float value = 0.0f;
+                stream >> value;
+                const auto & name = property.name;
+                if (name == "x") { vertex.position[0] = value; }
+                else if (name == "y") { vertex.position[1] = value; }
+                else if (name == "z") { vertex.position[2] = value; }
+                else if (name == "nx") { vertex.normal[0] = value; vertex.hasNormal = true; }
+                else if (name == "ny") { vertex.normal[1] = value; }
+                else if (name == "nz") { vertex.normal[2] = value; }
+                else {
+                    static const char * const channels[] = { "red", "green", "blue", "alpha" };
+                    for (std::size_t channel = 0; channel < 4; ++channel) {
+                        if (name != channels[channel]) { continue; }
+                        vertex.color[channel] = property.integer ? std::uint8_t(value) : toByte(value);
+                    }
+                }
+            }
+            if (!stream) { throw parseError(path, line, "invalid " + element.name); }
+
+            if (element.name == "vertex") {
+                vertices.push_back(vertex);
+            } else if (element.name == "face") {
+                if (indices.size() < 3) { throw parseError(path, line, "face has less than 3 vertices"); }
+                for (auto index : indices) {
+                    if (index < 0 || std::size_t(index) >= vertices.size()) {
+                        throw parseError(path, line, "index out of range");
+                    }
+                }
+                for (std::size_t idx = 2; idx < indices.size(); ++idx) {
+                    corners.insert(corners.end(), { vertices[std::size_t(indices[0])],
+                                                    vertices[std::size_t(indices[idx - 1])],
+                                                    vertices[std::size_t(indices[idx])] });
+                }
+            }
+        }
+    }
+    return corners;
+}
+
+/****************************************************************************/
+
+/// Fit quantization to the bounding box of all corners
+static Quantization fitQuantization(const std::vector<Corner> & corners)
+{
+    auto low = corners.front().position, high = low;
+    for (const auto & corner : corners) {
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            low[axis] = std::fmin(low[axis], corner.position[axis]);
+            high[axis] = std::fmax(high[axis], corner.position[axis]);
+        }
+    }
+    Quantization result;
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        result.scale[axis] = (high[axis] - low[axis]) / 2.0f;
+        result.bias[axis] = (high[axis] + low[axis]) / 2.0f;
+    }
+    return result;
+}
+
+/// Turn corners into mesh vertices, quantizing positions, packing normals and
+/// filling in missing ones
+static std::vector<MeshVertex> packCorners(const std::vector<Corner> & corners,
+                                           const Quantization & quantization)
+{
+    const auto normalize = [](vec3 value) {
+        const auto length = std::sqrt(value[0] * value[0] + value[1] * value[1] + value[2] * value[2]);
+        if (length > 0.0f) { for (auto & component : value) { component /= length; } }
+        return value;
+    };
+
+    std::vector<MeshVertex> vertices;
+    vertices.reserve(corners.size());
+    for (std::size_t idx = 0; idx < corners.size(); idx += 3) {
+        // Normal of the triangle, for corners without one. Degenerate triangles get a null normal.
+        const auto & a = corners[idx].position, & b = corners[idx + 1].position, & c = corners[idx + 2].position;
+        const vec3 ab = {{ b[0] - a[0], b[1] - a[1], b[2] - a[2] }};
+        const vec3 ac = {{ c[0] - a[0], c[1] - a[1], c[2] - a[2] }};
+        const auto face = normalize({{ ab[1] * ac[2] - ab[2] * ac[1],
+                                       ab[2] * ac[0] - ab[0] * ac[2],
+                                       ab[0] * ac[1] - ab[1] * ac[0] }});
+
+        for (std::size_t offset = 0; offset < 3; ++offset) {
+            const auto & corner = corners[idx + offset];
+            const auto normal = corner.hasNormal ? normalize(corner.normal) : face;
+            MeshVertex vertex;
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                vertex.position[axis] = quantization.encode(corner.position[axis], axis);
+            }
+            vertex.position[3] = 0;
+            vertex.normal = gl::packSnorm2101010(normal[0], normal[1], normal[2]);
+            std::memcpy(vertex.color, corner.color.data(), sizeof(vertex.color));
+            vertices.push_back(vertex);
+        }
+    }
+    return vertices;
+}
+
+/// Write an indexed mesh in binary format
+static void writeMesh(const std::string & path, const Mesh::Data<MeshVertex> & data,
+                      const Quantization & quantization)
+{
+    const auto align = [](std::uint64_t offset) {
+        return (offset + meshFileAlignment - 1) / meshFileAlignment * meshFileAlignment;
+    };
+    const bool narrow = data.vertices.size() <= std::numeric_limits<std::uint16_t>::max() + 1u;
+
+    MeshFileHeader header{};
+    std::memcpy(header.magic, meshFileMagic, sizeof(meshFileMagic));
+    header.version = meshFileVersion;
+    header.vertexSize = sizeof(MeshVertex);
+    header.vertexCount = std::uint32_t(data.vertices.size());
+    header.indexSize = narrow ? 2 : 4;
+    header.indexCount = std::uint32_t(data.indices.size());
+    header.vertexOffset = align(sizeof(header));
+    header.indexOffset = align(header.vertexOffset + std::uint64_t(header.vertexCount) * header.vertexSize);
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        header.positionScale[axis] = quantization.scale[axis];
+        header.positionBias[axis] = quantization.bias[axis];
+    }
+    // Bounding sphere of positions as the GPU sees them, after quantization
+    for (const auto & vertex : data.vertices) {
+        vec3 p;
+        for (std::size_t axis = 0; axis < 3; ++axis) { p[axis] = quantization.decode(vertex.position[axis], axis); }
+        header.radius = std::fmax(header.radius, std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]));
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    const auto pad = [&file](std::uint64_t offset) {
+        static const char zeros[meshFileAlignment] = {};
+        const auto position = std::uint64_t(file.tellp());
+        file.write(zeros, std::streamsize(offset - position));
+    };
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    pad(header.vertexOffset);
+    file.write(reinterpret_cast<const char *>(data.vertices.data()),
+               std::streamsize(data.vertices.size() * sizeof(MeshVertex)));
+    pad(header.indexOffset);
+    if (narrow) {
+        std::vector<std::uint16_t> indices(data.indices.begin(), data.indices.end());
+        file.write(reinterpret_cast<const char *>(indices.data()),
+                   std::streamsize(indices.size() * sizeof(std::uint16_t)));
+    } else {
+        file.write(reinterpret_cast<const char *>(data.indices.data()),
+                   std::streamsize(data.indices.size() * sizeof(GLuint)));
+    }
+    if (!file) { throw std::runtime_error(path + ": cannot write file"); }
+}
+
+/****************************************************************************/
+
+int main(int argc, char * argv[])
+{
+    if (argc != 3) {
+        std::cerr <<"Usage: " <<argv[0] <<" <input.obj|input.ply> <output.mesh>" <<std::endl;
+        return 1;
+    }
+    const std::string input = argv[1], output = argv[2];
+    try {
+        std::vector<Corner> corners;
+        if (endsWith(input, ".obj")) {
+            corners = readObj(input);
+        } else if (endsWith(input, ".ply")) {
+            corners = readPly(input);
+        } else {
+            throw std::runtime_error(input + ": unknown file type, expected .obj or .ply");
+        }
+        if (corners.empty()) { throw std::runtime_error(input + ": no faces"); }
+
+        const auto quantization = fitQuantization(corners);
+        const auto vertices = packCorners(corners, quantization);
+        auto data = Mesh::index(vertices.data(), vertices.size());
+        const auto before = Mesh::cacheMissRatio(data.indices, data.vertices.size());
+        Mesh::optimizeVertexCache(data.indices, data.vertices.size());
+        Mesh::optimizeVertexFetch(data);
+        const auto after = Mesh::cacheMissRatio(data.indices, data.vertices.size());
+        writeMesh(output, data, quantization);
+
+        std::cout <<input <<": " <<corners.size() / 3 <<" triangles, " <<data.vertices.size()
+                  <<" vertices, " <<before <<" -> " <<after <<" vertices per triangle" <<std::endl;
+    } catch (std::exception & error) {
+        std::cerr <<error.what() <<std::endl;
+        std::remove(output.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -2,6 +2,7 @@
 #define MODULE_H
 
 #include <cstdint>
+#include <limits>
 #include "config.h"
 
 namespace customlink {
@@ -14,15 +15,41 @@ struct Entry
     function_type * function;
 };
 
+namespace detail {
+
+// Whether text is the plain decimal spelling of value - no suffix, no leading zero -
+// and value fits in an int, which is what the linker can sort on.
+constexpr bool isSortableId(const char * text, uint64_t value)
+{
+    if (value > uint64_t(std::numeric_limits<int>::max())) { return false; }
+    if (text[0] == '0' && text[1] != '\0') { return false; }
+    uint64_t parsed = 0;
+    for (; *text != '\0'; ++text) {
+        if (*text < '0' || *text > '9') { return false; }
+        parsed = parsed * 10 + uint64_t(*text - '0');
+    }
+    return parsed == value;
+}
+
+} // namespace detail
+
+// Register a module. Each entry goes in its own .module_map.<id> section, which the
+// linker script sorts by id, making moduleMap a sorted array. Each also defines a
+// global symbol customlink_module_<id>, so registering an id twice fails to link.
 #define CUSTOMLINK_MODULE(fnid) \
+    static_assert(::customlink::detail::isSortableId(#fnid, fnid), \
+                  "module id must be a decimal literal no greater than INT_MAX"); \
     static void fn_##fnid(); \
-    static ::customlink::Entry __attribute__((section (".module_map"))) USED reg_##fnid = \
-        { fnid, &fn_##fnid }; \
+    extern "C" { ::customlink::Entry customlink_module_##fnid \
+        __attribute__((section (".module_map." #fnid))) USED = { fnid, &fn_##fnid }; } \
     static void fn_##fnid()
 
 extern "C" const Entry moduleMap[];
 extern "C" const Entry moduleMapEnd;
 
+// Get the module registered for id, or nullptr if none, with a binary search
+const Entry * find(uint64_t id) noexcept;
+
 } // namespace customlink
 
 #endif
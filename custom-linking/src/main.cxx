@@ -1,12 +1,32 @@
+#include <cstdlib>
 #include <iostream>
 #include "module.h"
 
-int main()
+int main(int argc, char * argv[])
 {
-    for (auto entry = customlink::moduleMap; entry != &customlink::moduleMapEnd; ++entry)
+    // Without arguments, list all modules, in id order
+    if (argc < 2) {
+        for (auto entry = customlink::moduleMap; entry != &customlink::moduleMapEnd; ++entry)
+        {
+            std::cout <<"Found module for id " <<entry->id <<", calling it...\n    ";
+            entry->function();
+        }
+        return 0;
+    }
+
+    // Otherwise, dispatch each id given on command line
+    int status = 0;
+    for (int i = 1; i < argc; ++i)
     {
-        std::cout <<"Found module for id " <<entry->id <<", calling it...\n    ";
+        const auto id = uint64_t(std::strtoull(argv[i], nullptr, 10));
+        const auto entry = customlink::find(id);
+        if (!entry) {
+            std::cerr <<"No module for id " <<id <<'\n';
+            status = 1;
+            continue;
+        }
+        std::cout <<"Calling module for id " <<id <<"...\n    ";
         entry->function();
     }
-    return 0;
+    return status;
 }
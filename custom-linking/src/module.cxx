@@ -0,0 +1,24 @@
+#include <algorithm>
+#include <cassert>
+#include "module.h"
+
+namespace customlink {
+
+const Entry * find(uint64_t id) noexcept
+{
+    const auto end = &moduleMapEnd;
+#ifndef NDEBUG
+    // Catch a linker not honoring SORT_BY_INIT_PRIORITY, once
+    static const bool sorted = std::is_sorted(moduleMap, end, [](const Entry & a, const Entry & b) {
+        return a.id < b.id;
+    });
+    assert(sorted);
+#endif
+
+    const auto entry = std::lower_bound(moduleMap, end, id, [](const Entry & item, uint64_t value) {
+        return item.id < value;
+    });
+    return entry != end && entry->id == id ? entry : nullptr;
+}
+
+} // namespace customlink
@@ -2,9 +2,12 @@
 #define APPLICATION_H
 
 #include <atomic>
-#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include "TripleBuffer.h"
 
 // Forward declare structs used in header to avoid including SDL.h
 struct SDL_Renderer;
@@ -14,6 +17,8 @@ struct SDL_WindowEvent;
 
 namespace app {
 
+class Batch;
+
 /****************************************************************************/
 
 // unique_ptr variants that properly destroy SDL resources
@@ -27,17 +32,27 @@ template <typename T> using sdl_ptr = std::unique_ptr<T, SDLDeleter<T>>;
 
 class Application final
 {
-    using milliseconds = std::chrono::duration<unsigned, std::milli>;
 public:
-    explicit    Application(const char * name);
+    // Create application window, simulating the world tickRate times per second
+    explicit    Application(const char * name, unsigned tickRate = 100);
                 ~Application();
 
     void    run();
     void    quit() noexcept { m_quit = true; }
 
 private:
-    void    update(milliseconds);
-    void    render(SDL_Renderer *);
+    // Snapshot of the world, handed from simulation thread to main thread. It holds
+    // the last two states, so rendering can interpolate between them.
+    struct Frame
+    {
+        float           previous = 0.0f;            // Angle of the triangle at second to last tick
+        float           current = 0.0f;             // Angle of the triangle at last tick
+        std::uint64_t   tickStart = 0;              // Performance counter when last tick was due
+    };
+
+    void    simulationLoop();
+    void    update();
+    void    render(Batch &, const Frame &, float alpha);
 
     void    onKeyDown(const SDL_KeyboardEvent &) noexcept;
     void    onKeyUp(const SDL_KeyboardEvent &) noexcept;
@@ -46,11 +61,19 @@ private:
 
 private:
     sdl_ptr<SDL_Window>     m_window;           // Main application window
-    sdl_ptr<SDL_Renderer>   m_renderer;         // Main renderer
 
     std::atomic<bool>       m_quit;
-    bool                    m_visible = false;  // Whether window is currently visible
+    std::atomic<bool>       m_visible{false};   // Whether window is currently visible
+    std::uint64_t           m_tickLength;       // Duration of a tick, in performance counter units
+
+    // World state, only touched by simulation thread
+    std::uint64_t           m_accumulator = 0;  // Time not simulated yet, in performance counter units
     float                   m_angle = 0.0f;     // Current angle of the triangle
+    float                   m_previousAngle = 0.0f; // Angle of the triangle at previous tick
+
+    TripleBuffer<Frame>     m_frames;           // Latest world state, from simulation thread
+    std::mutex              m_idleMutex;        // Guards simulation thread pausing while hidden
+    std::condition_variable m_idleWake;         // Wakes simulation thread when window shows or app quits
 };
 
 /****************************************************************************/
@@ -0,0 +1,82 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <SDL.h>
+#include <cstdint>
+#include <vector>
+
+namespace app {
+
+/****************************************************************************/
+
+// Immediate-mode batching of 2D primitives.
+//
+// Drawing functions only append vertices and indices to per-frame storage.
+// flush() then submits everything with as few SDL_RenderGeometry() calls as
+// possible: primitives are sorted by layer, then blend mode, then texture, and
+// each run sharing all three is drawn in a single call. Storage is cleared but
+// kept from frame to frame, so once it has grown to fit a frame, drawing
+// allocates nothing.
+//
+// Within a layer, primitives using different blend modes or textures may be
+// drawn in any order. Primitives that overlap and must be drawn in a given order
+// go on different layers, lower layers being drawn first. Primitives sharing
+// layer, blend mode and texture keep their order.
+//
+// Lines are drawn as thin quads, so they can have any width, and go in the same
+// calls as everything else.
+class Batch final
+{
+public:
+    explicit    Batch(SDL_Renderer *);
+                Batch(const Batch &) = delete;
+    Batch &     operator=(const Batch &) = delete;
+
+    SDL_Renderer * renderer() const noexcept { return m_renderer; }
+
+    // State applied to primitives added afterwards, until changed
+    void        setLayer(int layer) noexcept { m_layer = layer; }
+    void        setBlendMode(SDL_BlendMode mode) noexcept { m_blend = mode; }
+
+    void        line(SDL_FPoint from, SDL_FPoint to, SDL_Color, float width = 1.0f);
+    void        rect(const SDL_FRect &, SDL_Color);
+    void        triangle(SDL_FPoint, SDL_FPoint, SDL_FPoint, SDL_Color);
+    // Draw part of a texture given in texture coordinates, from 0 to 1, tinted by color
+    void        quad(SDL_Texture *, const SDL_FRect & dst,
+                     const SDL_FRect & uv = { 0.0f, 0.0f, 1.0f, 1.0f },
+                     SDL_Color = { 255, 255, 255, 255 });
+
+    // Draw everything added since last flush, and start over.
+    // Returns the number of SDL_RenderGeometry() calls it took.
+    std::size_t flush();
+
+private:
+    // A run of indices sharing the same state, in the order they were added
+    struct Command
+    {
+        int             layer;
+        SDL_BlendMode   blend;
+        SDL_Texture *   texture;
+        std::size_t     first;                  // Offset of first index in m_indices
+        std::size_t     count;                  // Number of indices
+    };
+
+    // Start a primitive of given index count, returning index of its first vertex
+    int         begin(SDL_Texture *, std::size_t indices);
+
+private:
+    SDL_Renderer *          m_renderer;
+    int                     m_layer = 0;
+    SDL_BlendMode           m_blend = SDL_BLENDMODE_BLEND;
+
+    std::vector<SDL_Vertex> m_vertices;         // This frame's vertices, in order added
+    std::vector<int>        m_indices;          // This frame's indices, in order added
+    std::vector<Command>    m_commands;         // This frame's runs, in order added
+    std::vector<int>        m_sorted;           // Indices reordered by flush(), kept for its storage
+};
+
+/****************************************************************************/
+
+} // namespace app
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef MATH_H
+#define MATH_H
+
+#include <SDL_rect.h>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace app {
+
+/****************************************************************************/
+
+constexpr float PI = 3.14159265359f;
+
+namespace detail {
+
+// Taylor series of sine, precise to double precision over [-pi, pi]
+constexpr double sine(double x) noexcept
+{
+    double term = x, sum = x;
+    for (int n = 1; n < 12; ++n) {
+        term *= -x * x / double((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+// Sine of size + 1 angles evenly spread over a full turn, the last one
+// repeating the first so interpolation never needs to wrap
+template <std::size_t size> constexpr std::array<float, size + 1> sineTable() noexcept
+{
+    constexpr double pi = 3.14159265358979323846;
+    std::array<float, size + 1> table{};
+    for (std::size_t i = 0; i <= size; ++i) {
+        double x = 2.0 * pi * double(i) / double(size);
+        if (x > pi) { x -= 2.0 * pi; }
+        table[i] = float(sine(x));
+    }
+    return table;
+}
+
+} // namespace detail
+
+// Lookup table for sin() and cos(), built at compile time. Linear interpolation
+// between entries keeps the error below 5e-6, about what float precision allows
+// for angles of a few turns.
+constexpr std::size_t sineTableSize = 1024;                 // Entries per turn, a power of two
+inline constexpr auto sineTable = detail::sineTable<sineTableSize>();
+
+struct SinCos { float sin, cos; };
+
+// Sine and cosine of angle, in radians, read from sineTable
+inline SinCos sincos(float angle) noexcept
+{
+    constexpr std::size_t mask = sineTableSize - 1;
+    const float position = angle * (float(sineTableSize) / (2.0f * PI));
+    const float index = std::floor(position);
+    const float fraction = position - index;
+    const auto s = std::size_t(std::int64_t(index)) & mask; // wraps negative angles too
+    const auto c = (s + sineTableSize / 4) & mask;          // cos(x) = sin(x + PI/2)
+    return {
+        sineTable[s] + fraction * (sineTable[s + 1] - sineTable[s]),
+        sineTable[c] + fraction * (sineTable[c + 1] - sineTable[c])
+    };
+}
+
+/****************************************************************************/
+
+// 2D affine transform, mapping (x, y) to (xx * x + xy * y + dx, yx * x + yy * y + dy)
+struct Transform
+{
+    float   xx, xy, yx, yy;
+    float   dx, dy;
+};
+
+// Rotate by angle, in radians, scale, then move origin to given point.
+// This is the only place computing a sine and cosine.
+Transform rotation(float angle, float scale, SDL_FPoint origin) noexcept;
+
+// Apply transform to count points from in, writing them to out, which may be the
+// same array. Uses SIMD instructions where available, transforming several points
+// per instruction.
+void transform(const Transform &, const SDL_FPoint * in, SDL_FPoint * out, std::size_t count) noexcept;
+
+/****************************************************************************/
+
+// Regular polygon with a fixed number of sides.
+//
+// Vertices of the unit polygon are computed once. Drawing it at any position,
+// size and orientation then only takes one transform of all vertices, instead of
+// a sine and cosine per vertex.
+class Polygon final
+{
+public:
+    // Create a polygon centered on the origin, with its first vertex at (1, 0)
+    explicit    Polygon(unsigned sides);
+
+    std::size_t size() const noexcept { return m_vertices.size(); }
+
+    // Write vertices, transformed, into out, which must have room for size() points
+    void        place(const Transform & transform, SDL_FPoint * out) const noexcept
+    {
+        app::transform(transform, m_vertices.data(), out, m_vertices.size());
+    }
+
+private:
+    std::vector<SDL_FPoint> m_vertices;         // Vertices of unit polygon
+};
+
+/****************************************************************************/
+
+} // namespace app
+
+#endif
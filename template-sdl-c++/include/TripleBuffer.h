@@ -0,0 +1,58 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+namespace app {
+
+/****************************************************************************/
+
+// Lock-free handoff of the latest value from one thread to another.
+//
+// The producer fills back(), then publish() swaps it with a middle slot. The
+// consumer's acquire() swaps the middle slot with front() if something new was
+// published. Each swap is a single atomic exchange, so neither thread ever
+// waits for the other. Values published faster than they are acquired are
+// simply skipped.
+//
+// Exactly one thread may produce, and exactly one other thread may consume.
+template <typename T> class TripleBuffer final
+{
+public:
+                TripleBuffer() = default;
+                TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer & operator=(const TripleBuffer &) = delete;
+
+    // Producer side
+    T &         back() noexcept { return m_slots[m_back].value; }
+    void        publish() noexcept
+    {
+        m_back = m_middle.exchange(m_back | fresh, std::memory_order_acq_rel) & index;
+    }
+
+    // Consumer side - acquire() returns false and keeps front() as is if nothing new
+    bool        acquire() noexcept
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & fresh) == 0) { return false; }
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & index;
+        return true;
+    }
+    const T &   front() const noexcept { return m_slots[m_front].value; }
+
+private:
+    static constexpr unsigned index = 0x3;      // Bits of m_middle holding slot index
+    static constexpr unsigned fresh = 0x4;      // Bit of m_middle set until it is acquired
+
+    struct alignas(64) Slot { T value{}; };     // One cache line per slot, avoiding false sharing
+
+    Slot                    m_slots[3];
+    alignas(64) std::atomic<unsigned> m_middle{1};
+    alignas(64) unsigned    m_back = 0;         // Only touched by producer
+    alignas(64) unsigned    m_front = 2;        // Only touched by consumer
+};
+
+/****************************************************************************/
+
+} // namespace app
+
+#endif
@@ -1,13 +1,19 @@
 #include "Application.h"
+#include "Batch.h"
+#include "Math.h"
 
 #include <SDL.h>
-#include <cmath>
+#include <algorithm>
 #include <iostream>
+#include <thread>
 
-static constexpr float PI = 3.14159265359f;
+static constexpr unsigned maxCatchUp = 250;     // Most time simulated at once, in milliseconds
+static constexpr unsigned hiddenTimeout = 250;  // Longest sleep while hidden, bounding time to notice m_quit
 
 namespace app {
 
+static const Polygon triangle(3);               // Shape drawn, computed once
+
 void SDLDeleter<SDL_Renderer>::operator()(SDL_Renderer * ptr) const { SDL_DestroyRenderer(ptr); }
 void SDLDeleter<SDL_Window>::operator()(SDL_Window * ptr) const { SDL_DestroyWindow(ptr); }
 
@@ -35,24 +41,37 @@ static sdl_ptr<SDL_Renderer> createRenderer(SDL_Window & window, Uint32 flags)
 
 /****************************************************************************/
 
-Application::Application(const char * name)
+Application::Application(const char * name, unsigned tickRate)
  : m_window(createWindow(name, 800, 600)),
-   m_renderer(createRenderer(*m_window, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC)),
-   m_quit(false)
+   m_quit(false),
+   m_tickLength(std::max<std::uint64_t>(1, SDL_GetPerformanceFrequency() / std::max(tickRate, 1u)))
 {}
 
 Application::~Application() = default;
 
 
+// Handle events and draw on this thread, while another one updates the world.
+// SDL's video and render functions must be called from the main thread, so this
+// is where they stay. Neither thread waits for the other, so simulation keeps its
+// pace even when presenting blocks on V-sync, and bursts of events do not delay it.
 void Application::run()
 {
-    auto lastTicks = milliseconds(SDL_GetTicks());
-
+    auto renderer = createRenderer(*m_window, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    Batch batch(renderer.get());
+    std::thread simulation(&Application::simulationLoop, this);
+
+    // Wake up simulation thread paused on a hidden window, once it can see why
+    const auto wakeSimulation = [this]() {
+        std::lock_guard<std::mutex> lock(m_idleMutex);
+        m_idleWake.notify_one();
+    };
     while (!m_quit) {
-        // Handle any waiting event
+        // Handle pending events. While hidden, there is nothing to draw, so sleep
+        // until an event comes, waking up now and then to check m_quit.
+        const bool visible = m_visible;
         SDL_Event event;
-        while(SDL_PollEvent(&event))
-        {
+        bool pending = visible ? SDL_PollEvent(&event) : SDL_WaitEventTimeout(&event, hiddenTimeout);
+        for (; pending; pending = SDL_PollEvent(&event)) {
             switch (event.type) {
             case SDL_KEYDOWN:       onKeyDown(event.key); break;
             case SDL_KEYUP:         onKeyUp(event.key); break;
@@ -60,46 +79,86 @@ void Application::run()
             case SDL_WINDOWEVENT:   onWindowEvent(event.window); break;
             }
         }
+        if (m_visible != visible) { wakeSimulation(); }
+        if (!m_visible) { continue; }
+
+        // Draw latest state between its last two ticks, by how far into the current one
+        // we are. Presenting waits for V-sync, which paces this loop.
+        m_frames.acquire();
+        const auto & frame = m_frames.front();
+        const auto now = SDL_GetPerformanceCounter();
+        const auto alpha = now > frame.tickStart
+                         ? std::min(1.0f, float(now - frame.tickStart) / float(m_tickLength))
+                         : 0.0f;
+        render(batch, frame, alpha);
+        batch.flush();
+        SDL_RenderPresent(renderer.get());
+    }
+    wakeSimulation();
+    simulation.join();
+}
 
-        // Keep track of elapsed time and feed it to update()
-        auto ticks = milliseconds(SDL_GetTicks());
-        update(ticks - lastTicks);
-        lastTicks = ticks;
+// Update the world at a fixed tick rate, so it behaves the same at any frame rate,
+// and publish every new state for the main thread to draw.
+void Application::simulationLoop()
+{
+    // Elapsed time accumulates until it makes up a whole tick. Beyond maxCatchUp,
+    // eg: after a breakpoint, lost time is skipped instead.
+    const auto frequency = SDL_GetPerformanceFrequency();
+    const auto maxAccumulator = std::max(maxCatchUp * frequency / 1000, m_tickLength);
+    auto last = SDL_GetPerformanceCounter();
+    while (!m_quit) {
+        // The world pauses while hidden, sleep until window shows or app quits
+        if (!m_visible) {
+            std::unique_lock<std::mutex> lock(m_idleMutex);
+            m_idleWake.wait(lock, [this]() { return m_quit || m_visible; });
+            last = SDL_GetPerformanceCounter();
+            continue;
+        }
 
-        if (m_visible) {
-            render(m_renderer.get());
-            SDL_RenderPresent(m_renderer.get());
+        // Run elapsed ticks, then hand the last two states over
+        const auto now = SDL_GetPerformanceCounter();
+        m_accumulator = std::min(m_accumulator + (now - last), maxAccumulator);
+        last = now;
+        while (m_accumulator >= m_tickLength) {
+            update();
+            m_accumulator -= m_tickLength;
         }
+        m_frames.back() = { m_previousAngle, m_angle, now - m_accumulator };
+        m_frames.publish();
+
+        // Sleep until next tick is due
+        const auto remaining = m_tickLength - m_accumulator;
+        SDL_Delay(Uint32((remaining * 1000 + frequency - 1) / frequency));  // never wake early
     }
 }
 
-// Update the state of the world - empty for still displays
-void Application::update(milliseconds ms)
+// Update the state of the world by one tick - empty for still displays
+void Application::update()
 {
-    m_angle += float(ms.count()) / 1000.0f;
-    if (m_angle > 2 * PI) { m_angle -= 2 * PI; }
+    m_previousAngle = m_angle;
+    m_angle += float(m_tickLength) / float(SDL_GetPerformanceFrequency());
+    if (m_angle > 2 * PI) {         // wrap both, so interpolating never goes backwards
+        m_angle -= 2 * PI;
+        m_previousAngle -= 2 * PI;
+    }
 }
 
-// Render a full view of current state of the world
-void Application::render(SDL_Renderer * renderer)
+// Render a full view of given state of the world
+void Application::render(Batch & batch, const Frame & frame, float alpha)
 {
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
-    SDL_RenderClear(renderer);
-
-    const int xc = 400, yc = 300; // center position
-    const float radius = 200.0f;
-    const SDL_Point points[] = {
-        {xc + int(radius * std::sin(m_angle + 0.0f*PI/3.0f)),
-         yc + int(radius * std::cos(m_angle + 0.0f*PI/3.0f))},
-        {xc + int(radius * std::sin(m_angle + 2.0f*PI/3.0f)),
-         yc + int(radius * std::cos(m_angle + 2.0f*PI/3.0f))},
-        {xc + int(radius * std::sin(m_angle + 4.0f*PI/3.0f)),
-         yc + int(radius * std::cos(m_angle + 4.0f*PI/3.0f))},
-        {xc + int(radius * std::sin(m_angle + 0.0f*PI/3.0f)),
-         yc + int(radius * std::cos(m_angle + 0.0f*PI/3.0f))},
-    };
-    SDL_SetRenderDrawColor(renderer, 128, 192, 255, 0);
-    SDL_RenderDrawLines(renderer, points, std::size(points));
+    SDL_SetRenderDrawColor(batch.renderer(), 0, 0, 0, 0);
+    SDL_RenderClear(batch.renderer());
+
+    // Rotating the whole shape takes a single sine and cosine, whatever its vertex count
+    const float angle = frame.previous + alpha * (frame.current - frame.previous);
+    SDL_FPoint points[3];
+    triangle.place(rotation(PI / 2.0f - angle, 200.0f, { 400.0f, 300.0f }), points);
+
+    const SDL_Color color = { 128, 192, 255, 255 };
+    for (std::size_t i = 0; i < triangle.size(); ++i) {
+        batch.line(points[i], points[(i + 1) % triangle.size()], color);
+    }
 }
 
 /****************************************************************************/
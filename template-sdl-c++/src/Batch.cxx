@@ -0,0 +1,126 @@
+#include "Batch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+
+#if !SDL_VERSION_ATLEAST(2, 0, 18)
+#error "Batch requires SDL 2.0.18 or later, for SDL_RenderGeometry()"
+#endif
+
+namespace app {
+
+/****************************************************************************/
+
+Batch::Batch(SDL_Renderer * renderer)
+ : m_renderer(renderer)
+{}
+
+// Account for a primitive's indices, extending last run if it shares its state
+int Batch::begin(SDL_Texture * texture, std::size_t indices)
+{
+    if (m_commands.empty()
+        || m_commands.back().layer != m_layer
+        || m_commands.back().blend != m_blend
+        || m_commands.back().texture != texture) {
+        m_commands.push_back({ m_layer, m_blend, texture, m_indices.size(), 0 });
+    }
+    m_commands.back().count += indices;
+    return int(m_vertices.size());
+}
+
+void Batch::line(SDL_FPoint from, SDL_FPoint to, SDL_Color color, float width)
+{
+    const float dx = to.x - from.x, dy = to.y - from.y;
+    const float length = std::sqrt(dx * dx + dy * dy);
+    if (length == 0.0f) { return; }
+
+    // Offset both ends by half the width, perpendicular to the line
+    const float nx = -dy * 0.5f * width / length, ny = dx * 0.5f * width / length;
+    const int base = begin(nullptr, 6);
+    m_vertices.push_back({ { from.x + nx, from.y + ny }, color, { 0.0f, 0.0f } });
+    m_vertices.push_back({ { from.x - nx, from.y - ny }, color, { 0.0f, 0.0f } });
+    m_vertices.push_back({ { to.x - nx, to.y - ny }, color, { 0.0f, 0.0f } });
+    m_vertices.push_back({ { to.x + nx, to.y + ny }, color, { 0.0f, 0.0f } });
+    m_indices.insert(m_indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+}
+
+void Batch::rect(const SDL_FRect & rect, SDL_Color color)
+{
+    const int base = begin(nullptr, 6);
+    m_vertices.push_back({ { rect.x, rect.y }, color, { 0.0f, 0.0f } });
+    m_vertices.push_back({ { rect.x + rect.w, rect.y }, color, { 0.0f, 0.0f } });
+    m_vertices.push_back({ { rect.x + rect.w, rect.y + rect.h }, color, { 0.0f, 0.0f } });
+    m_vertices.push_back({ { rect.x, rect.y + rect.h }, color, { 0.0f, 0.0f } });
+    m_indices.insert(m_indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+}
+
+void Batch::triangle(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c, SDL_Color color)
+{
+    const int base = begin(nullptr, 3);
+    m_vertices.push_back({ a, color, { 0.0f, 0.0f } });
+    m_vertices.push_back({ b, color, { 0.0f, 0.0f } });
+    m_vertices.push_back({ c, color, { 0.0f, 0.0f } });
+    m_indices.insert(m_indices.end(), { base, base + 1, base + 2 });
+}
+
+void Batch::quad(SDL_Texture * texture, const SDL_FRect & dst, const SDL_FRect & uv, SDL_Color color)
+{
+    const int base = begin(texture, 6);
+    m_vertices.push_back({ { dst.x, dst.y }, color, { uv.x, uv.y } });
+    m_vertices.push_back({ { dst.x + dst.w, dst.y }, color, { uv.x + uv.w, uv.y } });
+    m_vertices.push_back({ { dst.x + dst.w, dst.y + dst.h }, color, { uv.x + uv.w, uv.y + uv.h } });
+    m_vertices.push_back({ { dst.x, dst.y + dst.h }, color, { uv.x, uv.y + uv.h } });
+    m_indices.insert(m_indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+}
+
+/****************************************************************************/
+
+std::size_t Batch::flush()
+{
+    // Group runs by state. Stable sorting keeps the order primitives were added in
+    // within each group, and there are few runs unless state changes all the time.
+    std::stable_sort(m_commands.begin(), m_commands.end(),
+                     [](const Command & a, const Command & b) {
+        if (a.layer != b.layer) { return a.layer < b.layer; }
+        if (a.blend != b.blend) { return a.blend < b.blend; }
+        return std::less<SDL_Texture *>()(a.texture, b.texture);
+    });
+
+    // Gather indices of each group together, then draw it in one call. All calls share
+    // the whole vertex array, SDL only reads vertices that indices refer to.
+    std::size_t calls = 0;
+    auto it = m_commands.cbegin();
+    while (it != m_commands.cend()) {
+        const auto & state = *it;
+        m_sorted.clear();
+        for (; it != m_commands.cend() && it->layer == state.layer
+                                       && it->blend == state.blend
+                                       && it->texture == state.texture; ++it) {
+            const auto first = m_indices.cbegin() + std::ptrdiff_t(it->first);
+            m_sorted.insert(m_sorted.end(), first, first + std::ptrdiff_t(it->count));
+        }
+
+        // Untextured geometry uses the renderer's blend mode, textured geometry the texture's
+        const int result = state.texture
+                         ? SDL_SetTextureBlendMode(state.texture, state.blend)
+                         : SDL_SetRenderDrawBlendMode(m_renderer, state.blend);
+        if (result < 0
+            || SDL_RenderGeometry(m_renderer, state.texture,
+                                  m_vertices.data(), int(m_vertices.size()),
+                                  m_sorted.data(), int(m_sorted.size())) < 0) {
+            throw std::runtime_error(SDL_GetError());
+        }
+        ++calls;
+    }
+
+    m_vertices.clear();
+    m_indices.clear();
+    m_commands.clear();
+    return calls;
+}
+
+/****************************************************************************/
+
+} // namespace app
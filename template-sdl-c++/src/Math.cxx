@@ -0,0 +1,76 @@
+#include "Math.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace app {
+
+/****************************************************************************/
+
+Transform rotation(float angle, float scale, SDL_FPoint origin) noexcept
+{
+    const auto sc = sincos(angle);
+    return { scale * sc.cos, -scale * sc.sin, scale * sc.sin, scale * sc.cos, origin.x, origin.y };
+}
+
+// Points are stored as x, y pairs, so each SIMD register holds several points. Every
+// coordinate is the sum of itself and its neighbour in the pair, each multiplied by
+// its own factor, plus an offset. Swapping coordinates in pairs lines neighbours up.
+void transform(const Transform & t, const SDL_FPoint * in, SDL_FPoint * out, std::size_t count) noexcept
+{
+    std::size_t i = 0;
+#if defined(__AVX__)
+    {
+        const __m256 straight = _mm256_setr_ps(t.xx, t.yy, t.xx, t.yy, t.xx, t.yy, t.xx, t.yy);
+        const __m256 crossed = _mm256_setr_ps(t.xy, t.yx, t.xy, t.yx, t.xy, t.yx, t.xy, t.yx);
+        const __m256 offset = _mm256_setr_ps(t.dx, t.dy, t.dx, t.dy, t.dx, t.dy, t.dx, t.dy);
+        for (; i + 4 <= count; i += 4) {
+            const __m256 points = _mm256_loadu_ps(&in[i].x);
+            const __m256 swapped = _mm256_permute_ps(points, _MM_SHUFFLE(2, 3, 0, 1));
+            const __m256 result = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(points, straight),
+                                                              _mm256_mul_ps(swapped, crossed)),
+                                                offset);
+            _mm256_storeu_ps(&out[i].x, result);
+        }
+    }
+#endif
+#if defined(__SSE__)
+    {
+        const __m128 straight = _mm_setr_ps(t.xx, t.yy, t.xx, t.yy);
+        const __m128 crossed = _mm_setr_ps(t.xy, t.yx, t.xy, t.yx);
+        const __m128 offset = _mm_setr_ps(t.dx, t.dy, t.dx, t.dy);
+        for (; i + 2 <= count; i += 2) {
+            const __m128 points = _mm_loadu_ps(&in[i].x);
+            const __m128 swapped = _mm_shuffle_ps(points, points, _MM_SHUFFLE(2, 3, 0, 1));
+            const __m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(points, straight),
+                                                        _mm_mul_ps(swapped, crossed)),
+                                             offset);
+            _mm_storeu_ps(&out[i].x, result);
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        const auto point = in[i];
+        out[i] = { t.xx * point.x + t.xy * point.y + t.dx,
+                   t.yx * point.x + t.yy * point.y + t.dy };
+    }
+}
+
+/****************************************************************************/
+
+Polygon::Polygon(unsigned sides)
+ : m_vertices(sides)
+{
+    // Exact values rather than sincos(), this is only done once
+    for (unsigned i = 0; i < sides; ++i) {
+        const float angle = 2.0f * PI * float(i) / float(sides);
+        m_vertices[i] = { std::cos(angle), std::sin(angle) };
+    }
+}
+
+/****************************************************************************/
+
+} // namespace app
@@ -0,0 +1,99 @@
+// Compare ways of computing the vertices of a rotating regular polygon:
+//  - libm:     one std::sin() and std::cos() per vertex, at its own angle
+//  - table:    one table lookup sincos() per vertex
+//  - polygon:  one sincos() per frame, then one transform of precomputed vertices
+//
+// Usage: mathbench [frames]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "Math.h"
+
+using namespace app;
+using Clock = std::chrono::steady_clock;
+
+static constexpr SDL_FPoint center = { 400.0f, 300.0f };
+static constexpr float radius = 200.0f;
+
+static void libm(std::vector<SDL_FPoint> & out, float angle)
+{
+    const auto sides = out.size();
+    for (std::size_t i = 0; i < sides; ++i) {
+        const float vertex = angle + 2.0f * PI * float(i) / float(sides);
+        out[i] = { center.x + radius * std::sin(vertex), center.y + radius * std::cos(vertex) };
+    }
+}
+
+static void table(std::vector<SDL_FPoint> & out, float angle)
+{
+    const auto sides = out.size();
+    for (std::size_t i = 0; i < sides; ++i) {
+        const auto sc = sincos(angle + 2.0f * PI * float(i) / float(sides));
+        out[i] = { center.x + radius * sc.sin, center.y + radius * sc.cos };
+    }
+}
+
+// Run fn for given number of frames, returning nanoseconds per vertex
+template <typename F> static double measure(unsigned frames, std::size_t sides, F && fn)
+{
+    const auto start = Clock::now();
+    for (unsigned frame = 0; frame < frames; ++frame) { fn(0.01f * float(frame)); }
+    const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / double(frames) / double(sides);
+}
+
+// Largest distance between matching points
+static float error(const std::vector<SDL_FPoint> & a, const std::vector<SDL_FPoint> & b)
+{
+    float result = 0.0f;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        result = std::max({ result, std::abs(a[i].x - b[i].x), std::abs(a[i].y - b[i].y) });
+    }
+    return result;
+}
+
+
+int main(int argc, char * argv[])
+{
+    const unsigned frames = argc > 1 ? unsigned(std::atoi(argv[1])) : 200;
+
+    std::cout <<"Nanoseconds per vertex, over " <<frames <<" frames\n"
+              <<std::setw(8) <<"sides" <<std::setw(10) <<"libm" <<std::setw(10) <<"table"
+              <<std::setw(10) <<"polygon" <<std::setw(12) <<"max error" <<'\n'
+              <<std::fixed;
+
+    float checksum = 0.0f;
+    for (std::size_t sides : { 3u, 64u, 1024u, 16384u, 262144u }) {
+        std::vector<SDL_FPoint> reference(sides), points(sides);
+        const Polygon polygon{unsigned(sides)};
+        const auto frameCount = unsigned(std::max<std::size_t>(1, frames * 4096 / sides));
+
+        const double libmTime = measure(frameCount, sides, [&](float angle) {
+            libm(reference, angle); checksum += reference[0].x;
+        });
+        const double tableTime = measure(frameCount, sides, [&](float angle) {
+            table(points, angle); checksum += points[0].x;
+        });
+        const double polygonTime = measure(frameCount, sides, [&](float angle) {
+            polygon.place(rotation(PI / 2.0f - angle, radius, center), points.data());
+            checksum += points[0].x;
+        });
+
+        // Polygon vertices come in reverse order, compare with mirrored reference
+        const float angle = 1.0f;
+        libm(reference, angle);
+        polygon.place(rotation(PI / 2.0f - angle, radius, center), points.data());
+        std::reverse(points.begin() + 1, points.end());
+
+        std::cout <<std::setw(8) <<sides <<std::setprecision(2)
+                  <<std::setw(10) <<libmTime <<std::setw(10) <<tableTime
+                  <<std::setw(10) <<polygonTime
+                  <<std::setprecision(5) <<std::setw(12) <<error(reference, points) <<'\n';
+    }
+    std::cerr <<"checksum " <<checksum <<'\n';           // keeps results alive
+    return 0;
+}